@@ -0,0 +1,145 @@
+/******************************************************************************
+accessStats.c
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#include <stdint.h>
+#include <project.h>
+#include "devRegisters.h"
+#include "SCMD_config.h"
+#include "accessStats.h"
+
+#ifdef REGISTER_ACCESS_STATS
+
+//Register access statistics
+//
+//Counts host reads and writes of each register table location.  These are
+//counted where the user port comes in (readUserRegister() and friends), not in
+//readDevRegister(), which the firmware's own handlers call all the time.  Only
+//the first byte of a read burst counts, the rest is read ahead and may never
+//be sent.  Paged accesses aren't counted against the register table.
+//
+//Counters are 16 bit and stop at 0xFFFF.  Writing a register number to
+//SCMD_AST_CTRL copies the 16 counters from there into the page window and
+//refreshes the hot list and the refused map, so the page is one consistent
+//snapshot.
+
+#define STAT_REGISTERS 128
+#define STAT_MAX 0xFFFF
+
+static uint16_t readCounts[STAT_REGISTERS];
+static uint16_t writeCounts[STAT_REGISTERS];
+static uint8_t refusedBits[STAT_REGISTERS / 8];
+static uint8_t statsPage[SCMD_AST_LENGTH];
+
+void initAccessStats( void )
+{
+    mapRegisterPage( SCMD_PAGE_ACCESS_STATS, statsPage, SCMD_AST_LENGTH, false );
+}
+
+void countRegisterAccess( uint8_t regNumberIn, bool write )
+{
+    uint16_t * counts = write ? writeCounts : readCounts;
+    if( regNumberIn >= STAT_REGISTERS ) return; //Already in SCMD_REG_OOR_CNT
+    if( counts[regNumberIn] != STAT_MAX )
+    {
+        counts[regNumberIn]++;
+    }
+}
+
+void markRefusedAccess( uint8_t regNumberIn )
+{
+    if( regNumberIn >= STAT_REGISTERS ) return;
+    refusedBits[regNumberIn >> 3] |= 1 << ( regNumberIn & 0x07 );
+}
+
+//Hits of a register, reads and writes together
+static uint16_t getHits( uint8_t regNumberIn )
+{
+    uint32_t hits = (uint32_t)readCounts[regNumberIn] + writeCounts[regNumberIn];
+    return ( hits > STAT_MAX ) ? STAT_MAX : hits;
+}
+
+//Fill SCMD_AST_HOT with the most hit registers, most first
+static void buildHotList( void )
+{
+    uint8_t hotRegs[SCMD_AST_HOT_COUNT];
+    uint16_t hotHits[SCMD_AST_HOT_COUNT];
+    uint8_t i;
+    uint8_t j;
+    for( i = 0; i < SCMD_AST_HOT_COUNT; i++ )
+    {
+        hotRegs[i] = 0;
+        hotHits[i] = 0;
+    }
+    for( i = 0; i < STAT_REGISTERS; i++ )
+    {
+        uint16_t hits = getHits( i );
+        if( hits <= hotHits[SCMD_AST_HOT_COUNT - 1] ) continue;
+        //Insertion, drops the last entry
+        j = SCMD_AST_HOT_COUNT - 1;
+        while(( j > 0 )&&( hits > hotHits[j - 1] ))
+        {
+            hotRegs[j] = hotRegs[j - 1];
+            hotHits[j] = hotHits[j - 1];
+            j--;
+        }
+        hotRegs[j] = i;
+        hotHits[j] = hits;
+    }
+    for( i = 0; i < SCMD_AST_HOT_COUNT; i++ )
+    {
+        uint8_t * entry = &statsPage[SCMD_AST_HOT + ( i * SCMD_AST_HOT_STRIDE )];
+        entry[0] = hotRegs[i];
+        entry[1] = hotHits[i] & 0xFF;
+        entry[2] = hotHits[i] >> 8;
+    }
+}
+
+void accessStatsControl( uint8_t control )
+{
+    uint8_t i;
+    if( control & SCMD_AST_RESET )
+    {
+        for( i = 0; i < STAT_REGISTERS; i++ )
+        {
+            readCounts[i] = 0;
+            writeCounts[i] = 0;
+        }
+        for( i = 0; i < STAT_REGISTERS / 8; i++ )
+        {
+            refusedBits[i] = 0;
+        }
+        for( i = 0; i < SCMD_AST_LENGTH; i++ )
+        {
+            statsPage[i] = 0;
+        }
+        return;
+    }
+    for( i = 0; i < SCMD_AST_WINDOW_REGS; i++ )
+    {
+        uint8_t * entry = &statsPage[SCMD_AST_WINDOW + ( i * SCMD_AST_WINDOW_STRIDE )];
+        uint8_t regTemp = ( control + i ) & ( STAT_REGISTERS - 1 );
+        entry[0] = readCounts[regTemp] & 0xFF;
+        entry[1] = readCounts[regTemp] >> 8;
+        entry[2] = writeCounts[regTemp] & 0xFF;
+        entry[3] = writeCounts[regTemp] >> 8;
+    }
+    buildHotList();
+    for( i = 0; i < STAT_REGISTERS / 8; i++ )
+    {
+        statsPage[SCMD_AST_REFUSED + i] = refusedBits[i];
+    }
+    statsPage[SCMD_AST_CTRL] = control;
+}
+
+#endif
@@ -0,0 +1,32 @@
+/******************************************************************************
+accessStats.h
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#if !defined(ACCESSSTATS_H)
+#define ACCESSSTATS_H
+#include <stdint.h> 
+#include <stdbool.h>
+
+//Debug stuff
+//If REGISTER_ACCESS_STATS is defined, host accesses are counted per register and
+//reported on SCMD_PAGE_ACCESS_STATS (costs about 650 bytes of RAM):
+//#define REGISTER_ACCESS_STATS
+
+#ifdef REGISTER_ACCESS_STATS
+void initAccessStats( void );
+void countRegisterAccess( uint8_t regNumberIn, bool write ); //Page 0 and common registers
+void markRefusedAccess( uint8_t regNumberIn ); //Locked, read only or past the end of a page
+void accessStatsControl( uint8_t control ); //SCMD_AST_CTRL write
+#endif
+
+#endif
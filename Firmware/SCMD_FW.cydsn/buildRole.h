@@ -0,0 +1,66 @@
+/******************************************************************************
+buildRole.h
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#if !defined(BUILDROLE_H)
+#define BUILDROLE_H
+
+//Build roles
+//
+//The stock image (SCMD_ROLE_ANY) carries every role and the CONFIG_BITS jumpers
+//pick one at power up.  The other roles fix it at compile time: the role tests
+//below become constants, so the main loop and the serial setup only keep one
+//path and "Remove Unused Functions" drops the other roles' code.
+//
+//Set SCMD_BUILD_ROLE here, or per build in the project's Build Settings
+//(C/C++ > Preprocessor Definitions, e.g. SCMD_BUILD_ROLE=SCMD_ROLE_SLAVE).  The
+//build matrix and measured sizes are in Firmware/readme.md.
+#define SCMD_ROLE_ANY              0
+#define SCMD_ROLE_SLAVE            1  //Expansion port slave only
+#define SCMD_ROLE_MASTER_UART      2
+#define SCMD_ROLE_MASTER_SPI       3
+#define SCMD_ROLE_MASTER_I2C       4
+
+#if !defined(SCMD_BUILD_ROLE)
+#define SCMD_BUILD_ROLE SCMD_ROLE_ANY
+#endif
+
+//Role of a CONFIG_BITS value
+#if SCMD_BUILD_ROLE == SCMD_ROLE_ANY
+#define ROLE_IS_UART(bits)   (((bits) == 0)||((bits) == 0x0D)||((bits) == 0x0E))
+#define ROLE_IS_SPI(bits)    ((bits) == 1)
+#define ROLE_IS_SLAVE(bits)  ((bits) == 2)
+#define ROLE_IS_I2C(bits)    (((bits) >= 0x3)&&((bits) <= 0xC))
+#else
+#define ROLE_IS_UART(bits)   ( SCMD_BUILD_ROLE == SCMD_ROLE_MASTER_UART )
+#define ROLE_IS_SPI(bits)    ( SCMD_BUILD_ROLE == SCMD_ROLE_MASTER_SPI )
+#define ROLE_IS_SLAVE(bits)  ( SCMD_BUILD_ROLE == SCMD_ROLE_SLAVE )
+#define ROLE_IS_I2C(bits)    ( SCMD_BUILD_ROLE == SCMD_ROLE_MASTER_I2C )
+#endif
+
+//Whether the jumpers select the role this image was built for.  A fixed role image
+//doesn't run on a board jumpered for another role (see systemInit()): a board
+//jumpered as a slave must never come up as a master on a master image.
+#if SCMD_BUILD_ROLE == SCMD_ROLE_SLAVE
+#define ROLE_MATCHES(bits)  ((bits) == 2)
+#elif SCMD_BUILD_ROLE == SCMD_ROLE_MASTER_UART
+#define ROLE_MATCHES(bits)  (((bits) == 0)||((bits) == 0x0D)||((bits) == 0x0E))
+#elif SCMD_BUILD_ROLE == SCMD_ROLE_MASTER_SPI
+#define ROLE_MATCHES(bits)  ((bits) == 1)
+#elif SCMD_BUILD_ROLE == SCMD_ROLE_MASTER_I2C
+#define ROLE_MATCHES(bits)  (((bits) >= 0x3)&&((bits) <= 0xC))
+#else
+#define ROLE_MATCHES(bits)  1
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+/******************************************************************************
+capabilities.c
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#include <stdint.h>
+#include <project.h>
+#include "devRegisters.h"
+#include "SCMD_config.h"
+#include "serial.h"
+#include "accessStats.h"
+#include "buildRole.h"
+#include "capabilities.h"
+
+//Capability page
+//
+//Fixed when the image is built, so the table stays in flash.  The page is mapped
+//read only and nothing writes through it.  Add a SCMD_CAP_* bit here when a
+//feature goes in, the host library picks its transfers from these.
+
+#if defined(REGISTER_ACCESS_STATS)
+#define CAP_ACCESS_STATS SCMD_CAP_ACCESS_STATS
+#else
+#define CAP_ACCESS_STATS 0
+#endif
+
+#if defined(CY_PINS_HOST_ALERT_H)
+#define CAP_HOST_ALERT SCMD_CAP_HOST_ALERT
+#else
+#define CAP_HOST_ALERT 0
+#endif
+
+#define CAP_FLAGS ( SCMD_CAP_I2C_BURST | SCMD_CAP_PAGING | SCMD_CAP_PAGE_IN_WRITE \
+    | SCMD_CAP_BROADCAST | SCMD_CAP_REMOTE_QUEUE | SCMD_CAP_REMOTE_BLOCK | SCMD_CAP_EVENTS \
+    | CAP_HOST_ALERT | SCMD_CAP_OP_SEQ | SCMD_CAP_CONFIG_SAVE | SCMD_CAP_CONFIG_BLOB \
+    | SCMD_CAP_WIDE_DIAG | SCMD_CAP_CHANGES | CAP_ACCESS_STATS | SCMD_CAP_EXT_SLAVES )
+
+static const uint8_t capsTable[SCMD_CAP_LENGTH] = {
+    SCMD_CAP_FORMAT, //SCMD_CAP_VERSION
+    CAP_FLAGS & 0xFF,
+    CAP_FLAGS >> 8,
+    SCMD_BUILD_ROLE,
+    1, //SCMD_CAP_U_I2C_SPEED, 100 kHz (configI2C dataRate)
+    7, //SCMD_CAP_U_BAUD_MAX, 115200
+    3, //SCMD_CAP_E_BUS_SPEED_MAX
+    USER_PORT_BUFFER_SIZE, //SCMD_CAP_READ_BURST
+    USER_PORT_BUFFER_SIZE, //SCMD_CAP_WRITE_BURST
+    SCMD_REMQ_DEPTH,
+    SCMD_REM_BLK_MAX,
+    MAX_SLAVE_ADDR - START_SLAVE_ADDR + 1,
+    REGISTER_PAGE_COUNT
+};
+
+void initCapabilities( void )
+{
+    mapRegisterPage( SCMD_PAGE_CAPS, (uint8_t *)capsTable, SCMD_CAP_LENGTH, false );
+}
@@ -0,0 +1,368 @@
+/******************************************************************************
+configStore.c
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <project.h>
+#include "devRegisters.h"
+#include "SCMD_config.h"
+#include "serial.h"
+#include "configStore.h"
+#include "registerHandlers.h"
+#include "slaveEnumeration.h"
+
+//Saved configuration
+//
+//SCMD_SAVE_CONFIG_BIT in SCMD_CONTROL_1 writes the registers listed below (and
+//the extended slave inversion/bridging) to a record in flash.  Records rotate
+//through CONFIG_ROW_COUNT rows so each save wears a different row, and the
+//valid record with the newest sequence is loaded at boot.  A record from a
+//build with a different register list fails the length check and is ignored.
+//
+//Jumpers win over the record: with CONFIG_BITS 0x0D or 0x0E (UART at 57600 or
+//115200) the saved SCMD_U_BUS_UART_BAUD is not restored.
+
+#define CONFIG_ROW_COUNT 4
+#define CONFIG_MAGIC 0xC5
+
+//Registers kept across resets, in record order
+static const uint8_t savedRegisters[] =
+{
+    SCMD_MOTOR_A_INVERT,
+    SCMD_MOTOR_B_INVERT,
+    SCMD_BRIDGE,
+    SCMD_INV_2_9,
+    SCMD_INV_10_17,
+    SCMD_INV_18_25,
+    SCMD_INV_26_33,
+    SCMD_BRIDGE_SLV_L,
+    SCMD_BRIDGE_SLV_H,
+    SCMD_UPDATE_RATE,
+    SCMD_UPDATE_PERIOD_L,
+    SCMD_UPDATE_PERIOD_H,
+    SCMD_FSAFE_TIME,
+    SCMD_FSAFE_CTRL,
+    SCMD_U_BUS_UART_BAUD,
+    SCMD_E_BUS_SPEED,
+    SCMD_MST_BG_CTRL,
+    SCMD_FRAME_CTRL,
+};
+#define CONFIG_REGISTER_COUNT sizeof(savedRegisters)
+#define CONFIG_EXT_COUNT (SCMD_EXT_LENGTH - SCMD_EXT_INV)
+
+typedef struct
+{
+    uint8_t magic;
+    uint8_t length; //CONFIG_REGISTER_COUNT + CONFIG_EXT_COUNT when saved
+    uint16_t sequence; //Newest wins
+    uint8_t registers[CONFIG_REGISTER_COUNT];
+    uint8_t extSlave[CONFIG_EXT_COUNT];
+    uint16_t crc; //Over everything above
+} configRecord_t;
+
+//Row aligned so whole rows can be rewritten
+static const volatile uint8_t CY_ALIGN(CY_FLASH_SIZEOF_ROW) configFlash[CONFIG_ROW_COUNT][CY_FLASH_SIZEOF_ROW] = {{0}};
+
+static uint8_t activeRow = CONFIG_ROW_COUNT - 1; //Row of the newest record, next save goes after it
+static uint16_t activeSequence = 0;
+
+extern volatile bool slaveResetRequested;
+
+//Config blob
+//
+//The same settings as a saved record, laid out for the host to move in one burst
+//(SCMD_BLOB_*).  An import is checked and written to the register table in one
+//go, so nothing sees half of it.  The slaves' inversion and bridging then go out
+//in a single pass from the master loop, one write per slave, instead of through
+//the per-register handlers.
+static uint8_t blobPage[SCMD_BLOB_PAGE_LENGTH];
+static volatile bool blobReplicatePending = false;
+
+//Fails to compile if the record and SCMD_BLOB_* disagree
+typedef char blobLengthCheck[( SCMD_BLOB_CRC - SCMD_BLOB_DATA == CONFIG_REGISTER_COUNT + CONFIG_EXT_COUNT ) ? 1 : -1];
+
+//CRC-16/CCITT
+static uint16_t configCrc( const uint8_t * data, uint8_t length )
+{
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+    uint8_t bit;
+    for( i = 0; i < length; i++ )
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for( bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : ( crc << 1 );
+        }
+    }
+    return crc;
+}
+
+static void readRecord( uint8_t row, configRecord_t * record )
+{
+    uint8_t i;
+    for( i = 0; i < sizeof(configRecord_t); i++ )
+    {
+        ((uint8_t *)record)[i] = configFlash[row][i];
+    }
+}
+
+static bool recordValid( const configRecord_t * record )
+{
+    if(( record->magic != CONFIG_MAGIC )||( record->length != CONFIG_REGISTER_COUNT + CONFIG_EXT_COUNT ))
+    {
+        return false;
+    }
+    return record->crc == configCrc( (const uint8_t *)record, sizeof(configRecord_t) - sizeof(uint16_t) );
+}
+
+//Returns the flash row number (for CySysFlashWriteRow) of a config row
+static uint32_t flashRowNumber( uint8_t row )
+{
+    return ( (uint32_t)configFlash[row] - CY_FLASH_BASE ) / CY_FLASH_SIZEOF_ROW;
+}
+
+static cystatus writeRow( uint8_t row, const uint8_t * data, uint8_t length )
+{
+    uint8_t rowData[CY_FLASH_SIZEOF_ROW];
+    uint8_t i;
+    for( i = 0; i < CY_FLASH_SIZEOF_ROW; i++ )
+    {
+        rowData[i] = ( i < length ) ? data[i] : 0;
+    }
+    //The CPU stalls while the row programs, let the drive frame finish first
+    waitExpansionFrameDone();
+    return CySysFlashWriteRow( flashRowNumber( row ), rowData );
+}
+
+void restoreConfig( void )
+{
+    configRecord_t record;
+    bool found = false;
+    uint8_t row;
+    uint8_t i;
+    
+    writeDevRegisterUnprotected( SCMD_CONFIG_STATUS, 0 );
+    for( row = 0; row < CONFIG_ROW_COUNT; row++ )
+    {
+        readRecord( row, &record );
+        if( recordValid( &record ) )
+        {
+            if(( found == false )||( (int16_t)( record.sequence - activeSequence ) > 0 ))
+            {
+                found = true;
+                activeRow = row;
+                activeSequence = record.sequence;
+            }
+        }
+    }
+    if( found == false )
+    {
+        return;
+    }
+    readRecord( activeRow, &record );
+    uint8_t configBits = readDevRegister( SCMD_CONFIG_BITS );
+    for( i = 0; i < CONFIG_REGISTER_COUNT; i++ )
+    {
+        if(( savedRegisters[i] == SCMD_U_BUS_UART_BAUD )&&(( configBits == 0x0D )||( configBits == 0x0E )))
+        {
+            //Baud picked by jumper
+            continue;
+        }
+        writeDevRegister( savedRegisters[i], record.registers[i] );
+    }
+    for( i = 0; i < CONFIG_EXT_COUNT; i++ )
+    {
+        writeExtSlaveSetting( SCMD_EXT_INV + i, record.extSlave[i] );
+    }
+    //Replay the slave settings once the chain is up
+    slaveResetRequested = true;
+    writeDevRegisterUnprotected( SCMD_CONFIG_STATUS, SCMD_CFG_RESTORED );
+}
+
+void saveConfig( void )
+{
+    configRecord_t record;
+    uint8_t row = ( activeRow + 1 ) % CONFIG_ROW_COUNT;
+    uint8_t i;
+    
+    record.magic = CONFIG_MAGIC;
+    record.length = CONFIG_REGISTER_COUNT + CONFIG_EXT_COUNT;
+    record.sequence = activeSequence + 1;
+    for( i = 0; i < CONFIG_REGISTER_COUNT; i++ )
+    {
+        record.registers[i] = readDevRegister( savedRegisters[i] );
+    }
+    for( i = 0; i < CONFIG_EXT_COUNT; i++ )
+    {
+        record.extSlave[i] = readExtSlaveSetting( SCMD_EXT_INV + i );
+    }
+    record.crc = configCrc( (const uint8_t *)&record, sizeof(configRecord_t) - sizeof(uint16_t) );
+    
+    uint8_t status = readDevRegister( SCMD_CONFIG_STATUS ) & ~( SCMD_CFG_SAVED | SCMD_CFG_FAILED );
+    if( writeRow( row, (const uint8_t *)&record, sizeof(configRecord_t) ) == CY_SYS_FLASH_SUCCESS )
+    {
+        activeRow = row;
+        activeSequence = record.sequence;
+        status |= SCMD_CFG_SAVED;
+    }
+    else
+    {
+        status |= SCMD_CFG_FAILED;
+    }
+    writeDevRegisterUnprotected( SCMD_CONFIG_STATUS, status );
+}
+
+void clearConfig( void )
+{
+    configRecord_t record;
+    uint8_t row;
+    uint8_t status = readDevRegister( SCMD_CONFIG_STATUS ) & ~( SCMD_CFG_SAVED | SCMD_CFG_FAILED );
+    
+    //Only rows holding a record get written
+    for( row = 0; row < CONFIG_ROW_COUNT; row++ )
+    {
+        readRecord( row, &record );
+        if(( recordValid( &record ) )&&( writeRow( row, 0, 0 ) != CY_SYS_FLASH_SUCCESS ))
+        {
+            status |= SCMD_CFG_FAILED;
+        }
+    }
+    writeDevRegisterUnprotected( SCMD_CONFIG_STATUS, status );
+}
+
+void initConfigBlob( void )
+{
+    mapRegisterPage( SCMD_PAGE_CONFIG_BLOB, blobPage, SCMD_BLOB_PAGE_LENGTH, true );
+}
+
+static void exportConfigBlob( void )
+{
+    uint8_t i;
+    uint16_t crc;
+    blobPage[SCMD_BLOB_VERSION] = SCMD_BLOB_FORMAT;
+    blobPage[SCMD_BLOB_LENGTH] = CONFIG_REGISTER_COUNT + CONFIG_EXT_COUNT;
+    for( i = 0; i < CONFIG_REGISTER_COUNT; i++ )
+    {
+        blobPage[SCMD_BLOB_DATA + i] = readDevRegister( savedRegisters[i] );
+    }
+    for( i = 0; i < CONFIG_EXT_COUNT; i++ )
+    {
+        blobPage[SCMD_BLOB_DATA + CONFIG_REGISTER_COUNT + i] = readExtSlaveSetting( SCMD_EXT_INV + i );
+    }
+    crc = configCrc( blobPage, SCMD_BLOB_CRC );
+    blobPage[SCMD_BLOB_CRC] = crc & 0xFF;
+    blobPage[SCMD_BLOB_CRC + 1] = crc >> 8;
+}
+
+static bool importConfigBlob( void )
+{
+    uint8_t i;
+    uint8_t interruptState;
+    uint16_t crc = blobPage[SCMD_BLOB_CRC] | ( blobPage[SCMD_BLOB_CRC + 1] << 8 );
+    if(( blobPage[SCMD_BLOB_VERSION] != SCMD_BLOB_FORMAT )||( blobPage[SCMD_BLOB_LENGTH] != CONFIG_REGISTER_COUNT + CONFIG_EXT_COUNT ))
+    {
+        return false;
+    }
+    if( crc != configCrc( blobPage, SCMD_BLOB_CRC ))
+    {
+        return false;
+    }
+    //All or nothing, a locked register the blob would change refuses the whole
+    //blob.  Values that match are skipped, so a blob exported from this board
+    //imports without the master key as long as it keeps SCMD_U_BUS_UART_BAUD.
+    interruptState = CyEnterCriticalSection();
+    for( i = 0; i < CONFIG_REGISTER_COUNT; i++ )
+    {
+        if(( readDevRegister( savedRegisters[i] ) != blobPage[SCMD_BLOB_DATA + i] )&&( getWritableStatus( savedRegisters[i] ) == false ))
+        {
+            CyExitCriticalSection( interruptState );
+            return false;
+        }
+    }
+    for( i = 0; i < CONFIG_EXT_COUNT; i++ )
+    {
+        if(( readExtSlaveSetting( SCMD_EXT_INV + i ) != blobPage[SCMD_BLOB_DATA + CONFIG_REGISTER_COUNT + i] )&&( getExtSlaveWritableStatus( SCMD_EXT_INV + i ) == false ))
+        {
+            CyExitCriticalSection( interruptState );
+            return false;
+        }
+    }
+    for( i = 0; i < CONFIG_REGISTER_COUNT; i++ )
+    {
+        if( readDevRegister( savedRegisters[i] ) != blobPage[SCMD_BLOB_DATA + i] )
+        {
+            writeDevRegister( savedRegisters[i], blobPage[SCMD_BLOB_DATA + i] );
+        }
+    }
+    for( i = 0; i < CONFIG_EXT_COUNT; i++ )
+    {
+        writeExtSlaveSetting( SCMD_EXT_INV + i, blobPage[SCMD_BLOB_DATA + CONFIG_REGISTER_COUNT + i] );
+    }
+    CyExitCriticalSection( interruptState );
+    return true;
+}
+
+void configBlobControl( uint8_t control )
+{
+    uint8_t status = readDevRegister( SCMD_CONFIG_STATUS ) & ~( SCMD_CFG_IMPORTED | SCMD_CFG_REJECTED );
+    if( control & SCMD_BLOB_EXPORT )
+    {
+        exportConfigBlob();
+    }
+    if( control & SCMD_BLOB_IMPORT )
+    {
+        if( importConfigBlob() )
+        {
+            status |= SCMD_CFG_IMPORTED;
+            blobReplicatePending = true;
+            blobPage[SCMD_BLOB_CTRL] = SCMD_BLOB_IMPORT;
+        }
+        else
+        {
+            status |= SCMD_CFG_REJECTED;
+        }
+        writeDevRegisterUnprotected( SCMD_CONFIG_STATUS, status );
+    }
+}
+
+void serviceConfigBlob( void )
+{
+    uint8_t address;
+    if(( blobReplicatePending == false )||( masterSMDone() == false ))
+    {
+        return;
+    }
+    blobReplicatePending = false;
+    for( address = START_SLAVE_ADDR; address <= readDevRegister( SCMD_SLV_TOP_ADDR ); address++ )
+    {
+        sendSlaveSettings( address );
+    }
+    //Already sent, skip the per-register handlers
+    clearBusyBitMem( SCMD_INV_2_9 );
+    clearChangedStatus( SCMD_INV_2_9 );
+    clearBusyBitMem( SCMD_INV_10_17 );
+    clearChangedStatus( SCMD_INV_10_17 );
+    clearBusyBitMem( SCMD_INV_18_25 );
+    clearChangedStatus( SCMD_INV_18_25 );
+    clearBusyBitMem( SCMD_INV_26_33 );
+    clearChangedStatus( SCMD_INV_26_33 );
+    clearBusyBitMem( SCMD_BRIDGE_SLV_L );
+    clearChangedStatus( SCMD_BRIDGE_SLV_L );
+    clearBusyBitMem( SCMD_BRIDGE_SLV_H );
+    clearChangedStatus( SCMD_BRIDGE_SLV_H );
+    getExtSlaveChanged(); //Syncs the shadow
+    clearExtSlaveBusy();
+    blobPage[SCMD_BLOB_CTRL] = 0;
+}
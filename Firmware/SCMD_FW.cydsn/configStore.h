@@ -0,0 +1,27 @@
+/******************************************************************************
+configStore.h
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#if !defined(CONFIGSTORE_H)
+#define CONFIGSTORE_H
+#include <stdint.h> 
+#include <stdbool.h>
+
+void restoreConfig( void ); //Load saved settings over the cold init values, call before the state machines run
+void saveConfig( void ); //Write the current settings to flash
+void clearConfig( void ); //Forget saved settings, next boot uses defaults
+void initConfigBlob( void ); //Map the config blob page
+void configBlobControl( uint8_t control ); //SCMD_BLOB_CTRL write
+void serviceConfigBlob( void ); //Master loop, sends imported settings to the slaves
+
+#endif
@@ -166,7 +166,7 @@ void parseSPI( void )
             //Command is READ, NOT WRITE
             masterAddressPointer = rxTemp[0] & 0x7F;
             USER_PORT_SpiUartClearTxBuffer();
-            volatile uint8_t reg = readDevRegister( masterAddressPointer );
+            volatile uint8_t reg = readUserRegister( masterAddressPointer );
             USER_PORT_SpiUartWriteTxData(reg); //This will be available on next read, during command bits
             //We should check that the buffer doesn't have unused data and count!
             //But we won't...
@@ -181,7 +181,7 @@ void parseSPI( void )
             {
                 case 2: //Buffer has command and data
                     masterAddressPointer = rxTemp[0] & 0x7F;
-                    writeDevRegister( masterAddressPointer, rxTemp[1] ); //Write the next byte
+                    writeUserRegister( masterAddressPointer, rxTemp[1] ); //Write the next byte
                     USER_PORT_SpiUartClearRxBuffer();
                     rxTempPtr = 0;
                 break;
@@ -334,29 +334,9 @@ void parseUART( void )
                 {
                     writeDevRegister(SCMD_MOTOR_B_INVERT, 0x01);
                 }
-                else if(motorNum < 10) //must be 2 through 9
+                else //Slave motor, 2 and up
                 {
-                    dataTemp = readDevRegister(SCMD_INV_2_9);
-                    dataTemp |= 0x01 << (motorNum - 2);
-                    writeDevRegister(SCMD_INV_2_9, dataTemp);
-                }
-                else if(motorNum < 18) //must be 10 through 17
-                {
-                    dataTemp = readDevRegister(SCMD_INV_10_17);
-                    dataTemp |= 0x01 << (motorNum - 10);
-                    writeDevRegister(SCMD_INV_10_17, dataTemp);
-                }
-                else if(motorNum < 26) //must be 18 through 25
-                {
-                    dataTemp = readDevRegister(SCMD_INV_18_25);
-                    dataTemp |= 0x01 << (motorNum - 18);
-                    writeDevRegister(SCMD_INV_18_25, dataTemp);
-                }
-                else if(motorNum < 34) //must be 26 through 33
-                {
-                    dataTemp = readDevRegister(SCMD_INV_26_33);
-                    dataTemp |= 0x01 << (motorNum - 26);
-                    writeDevRegister(SCMD_INV_26_33, dataTemp);
+                    writeMotorInvert(motorNum, 0x01);
                 }
             }
             //Check for polarity switching
@@ -381,29 +361,9 @@ void parseUART( void )
                 {
                     writeDevRegister(SCMD_MOTOR_B_INVERT, 0x00);
                 }
-                else if(motorNum < 10) //must be 2 through 9
-                {
-                    dataTemp = readDevRegister(SCMD_INV_2_9);
-                    dataTemp &= ~(0x01 << (motorNum - 2));
-                    writeDevRegister(SCMD_INV_2_9, dataTemp);
-                }
-                else if(motorNum < 18) //must be 10 through 17
-                {
-                    dataTemp = readDevRegister(SCMD_INV_10_17);
-                    dataTemp &= ~(0x01 << (motorNum - 10));
-                    writeDevRegister(SCMD_INV_10_17, dataTemp);
-                }
-                else if(motorNum < 26) //must be 18 through 25
-                {
-                    dataTemp = readDevRegister(SCMD_INV_18_25);
-                    dataTemp &= ~(0x01 << (motorNum - 18));
-                    writeDevRegister(SCMD_INV_18_25, dataTemp);
-                }
-                else if(motorNum < 34) //must be 26 through 33
+                else //Slave motor, 2 and up
                 {
-                    dataTemp = readDevRegister(SCMD_INV_26_33);
-                    dataTemp &= ~(0x01 << (motorNum - 26));
-                    writeDevRegister(SCMD_INV_26_33, dataTemp);
+                    writeMotorInvert(motorNum, 0x00);
                 }
             }
             else
@@ -421,7 +381,7 @@ void parseUART( void )
                 if( motorNum < maxMotorCount )
                 {
                     //Perform remote write
-                    writeDevRegister( SCMD_MA_DRIVE + motorNum, motorDir * ((motorDrive * 127) / 100) + 128 );
+                    writeMotorDrive( motorNum, motorDir * ((motorDrive * 127) / 100) + 128 );
                 }
                 else
                 {
@@ -436,7 +396,7 @@ void parseUART( void )
             {
                 addressTemp = char2hex(rxBuffer[1]) << 4 | char2hex(rxBuffer[2]);
                 dataTemp = char2hex(rxBuffer[3]) << 4 | char2hex(rxBuffer[4]);
-                writeDevRegister(addressTemp, dataTemp);
+                writeUserRegister(addressTemp, dataTemp);
             }
             else
             {
@@ -449,7 +409,7 @@ void parseUART( void )
             if( ishex(rxBuffer[1])&&ishex(rxBuffer[2]) )
             {
                 addressTemp = char2hex(rxBuffer[1]) << 4 | char2hex(rxBuffer[2]);
-                dataTemp = readDevRegister(addressTemp);
+                dataTemp = readUserRegister(addressTemp);
 				USER_PORT_UartPutString("\r\n");
                 USER_PORT_UartPutChar(hex2char((dataTemp&0xF0) >> 4));
                 USER_PORT_UartPutChar(hex2char(dataTemp&0x0F));
@@ -466,48 +426,44 @@ void parseUART( void )
             if( ishex(rxBuffer[1]) )
             {
                 USER_PORT_UartPutString("\r\n");
-				saveKeysFullAccess(); //allow writes to registers
-
                 switch(rxBuffer[1])
                 {
                     case '0':
                     USER_PORT_UartPutString("2400\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 0);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 0);
                     break;
                     case '1':
                     USER_PORT_UartPutString("4800\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 1);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 1);
                     break;
                     case '2':
                     USER_PORT_UartPutString("9600\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 2);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 2);
                     break;
                     case '3':
                     USER_PORT_UartPutString("14400\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 3);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 3);
                     break;
                     case '4':
                     USER_PORT_UartPutString("19200\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 4);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 4);
                     break;
                     case '5':
                     USER_PORT_UartPutString("38400\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 5);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 5);
                     break;
                     case '6':
                     USER_PORT_UartPutString("57600\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 6);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 6);
                     break;
                     case '7':
                     USER_PORT_UartPutString("115200\r\n");
-                    writeDevRegister(SCMD_U_BUS_UART_BAUD, 7);
+                    writeDevRegisterInternal(SCMD_U_BUS_UART_BAUD, 7);
                     break;
                     default:
                     break;
                 }
-				
-				restoreKeys();//Replace previous keys
-				
+
                 //Cause the update, but give time to print the new speed at the old speed:
                 CyDelay(400);
                 calcUserDivider(readDevRegister(SCMD_CONFIG_BITS));
@@ -657,28 +613,36 @@ void parseI2C( void )
         }
         
         /* Check packet length */
-        if (USER_PORT_I2CSlaveGetWriteBufSize() == 2)
+        uint32 writeSize = USER_PORT_I2CSlaveGetWriteBufSize();
+        if(( writeSize >= 3 )&&( bufferRx[0] == SCMD_PAGE_SELECT ))
         {
-            //we have a address and data to write
+            //Page switch: page, offset on that page, then any data for it.  Saves a
+            //transfer per paged access, the page stays selected afterwards.
+            writeUserRegister( SCMD_PAGE_SELECT, bufferRx[1] );
+            addressPointer = bufferRx[2];
+            writeUserRegisterBurst(addressPointer, &bufferRx[3], writeSize - 3);
+        }
+        else if (writeSize >= 2)
+        {
+            //we have a address and data to write, more than one byte is a burst to consecutive registers
             addressPointer = bufferRx[0];
-            writeDevRegister(addressPointer, bufferRx[1]);
+            writeUserRegisterBurst(addressPointer, &bufferRx[1], writeSize - 1);
         }
-        else if (USER_PORT_I2CSlaveGetWriteBufSize() == 1)
+        else if (writeSize == 1)
         {
             //we have a address only, expose
             //for now, limit address
             addressPointer = bufferRx[0];
         }
-        else if (USER_PORT_I2CSlaveGetWriteBufSize() > 2)
-        {
-            //Something was wrong with the ammount of data in the buffer.  It will be dumped, but keep a count
-            incrementDevRegister( SCMD_U_BUF_DUMPED );
-        }
         //Count errors while clearing the status
-        if( USER_PORT_I2CSlaveClearWriteStatus() & USER_PORT_I2C_SSTAT_WR_ERR ) incrementDevRegister( SCMD_U_I2C_WR_ERR );
+        uint32 writeStatus = USER_PORT_I2CSlaveClearWriteStatus();
+        if( writeStatus & USER_PORT_I2C_SSTAT_WR_ERR ) incrementDevRegister( SCMD_U_I2C_WR_ERR );
+        //Burst was longer than the buffer, the rest was dumped.  Keep a count
+        if( writeStatus & USER_PORT_I2C_SSTAT_WR_OVFL ) incrementDevRegister( SCMD_U_BUF_DUMPED );
         
         USER_PORT_I2CSlaveClearWriteBuf();
-        bufferTx[0] = readDevRegister(addressPointer);
+        //Expose a full buffer so the host can burst read from addressPointer
+        readUserRegisterBurst(addressPointer, bufferTx, USER_PORT_BUFFER_SIZE);
         LED_PULSE_Write(0);
     }
     //expose data
@@ -719,30 +683,41 @@ void parseSlaveI2C( void )
             clearDiagMessage(7);
         }
          /* Check packet length */
-        switch( EXPANSION_PORT_I2CSlaveGetWriteBufSize() )
+        uint32 writeSize = EXPANSION_PORT_I2CSlaveGetWriteBufSize();
+        uint32 i;
+        if(( writeSize >= 2 )&&( expansionBufferRx[0] == BROADCAST_TAG ))
         {
-            case 3:
-                //we have a address and 2 data to write
-                expansionAddressPointer = expansionBufferRx[0];
-                writeDevRegister(expansionAddressPointer, expansionBufferRx[1]);
-                writeDevRegister(expansionAddressPointer + 1, expansionBufferRx[2]);
-            break;
-            case 2:
-                //we have a address and data to write
-                expansionAddressPointer = expansionBufferRx[0];
-                writeDevRegister(expansionAddressPointer, expansionBufferRx[1]);
-            break;
-            case 1:
-                //we have a address only, expose
-                //for now, limit address
-                expansionAddressPointer = expansionBufferRx[0];
-            break;
-            default:
-            break;
+            //Broadcast frame, take this slave's pair and leave the pointer alone
+            i = 1 + (( readDevRegister( SCMD_SLAVE_ADDR ) - START_SLAVE_ADDR ) << 1 );
+            if( i + 1 < writeSize )
+            {
+                writeDevRegister( SCMD_MA_DRIVE, expansionBufferRx[i] );
+                writeDevRegister( SCMD_MB_DRIVE, expansionBufferRx[i + 1] );
+            }
+        }
+        else if( writeSize >= 2 )
+        {
+            //we have a address and data to write, more than one is a block to consecutive registers
+            expansionAddressPointer = expansionBufferRx[0];
+            for( i = 1; i < writeSize; i++ )
+            {
+                writeDevRegister(expansionAddressPointer + i - 1, expansionBufferRx[i]);
+            }
+        }
+        else if( writeSize == 1 )
+        {
+            //we have a address only, expose
+            expansionAddressPointer = expansionBufferRx[0];
         }
         //Count errors while clearing the status
-        if( EXPANSION_PORT_I2CSlaveClearWriteStatus() & EXPANSION_PORT_I2C_SSTAT_WR_ERR ) incrementDevRegister( SCMD_E_I2C_WR_ERR );
+        if( EXPANSION_PORT_I2CSlaveClearWriteStatus() & EXPANSION_PORT_I2C_SSTAT_WR_ERR )
+        {
+            incrementDevRegister( SCMD_E_I2C_WR_ERR );
+            setFaultFlag( SCMD_FAULT_E_I2C );
+        }
         EXPANSION_PORT_I2CSlaveClearWriteBuf();
+        //Expose a block from the pointer for block reads
+        readDevRegisterBurst(expansionAddressPointer, expansionBufferTx, EXPANSION_PORT_BUFFER_SIZE);
         LED_PULSE_Write(0);
 
     }
@@ -755,7 +730,11 @@ void parseSlaveI2C( void )
         /* Clear slave read buffer and status */
         EXPANSION_PORT_I2CSlaveClearReadBuf();
         //Count errors while clearing the status
-        if( EXPANSION_PORT_I2CSlaveClearReadStatus() & EXPANSION_PORT_I2C_SSTAT_RD_ERR ) incrementDevRegister( SCMD_E_I2C_RD_ERR );
+        if( EXPANSION_PORT_I2CSlaveClearReadStatus() & EXPANSION_PORT_I2C_SSTAT_RD_ERR )
+        {
+            incrementDevRegister( SCMD_E_I2C_RD_ERR );
+            setFaultFlag( SCMD_FAULT_E_I2C );
+        }
     }
 }
 
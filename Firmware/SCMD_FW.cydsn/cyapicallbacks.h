@@ -0,0 +1,18 @@
+/* ========================================
+ *
+ * Component API callbacks
+ *
+ * Macros defined here enable the matching callback hooks in the generated
+ * component code.  The callback functions live in the project source.
+ *
+ * ========================================
+*/
+#ifndef CYAPICALLBACKS_H
+#define CYAPICALLBACKS_H
+    
+    //Expansion port ISR exit -- chains the drive frame (serial.c)
+    #define EXPANSION_PORT_I2C_ISR_EXIT_CALLBACK
+    void EXPANSION_PORT_I2C_ISR_ExitCallback( void );
+    
+#endif /* CYAPICALLBACKS_H */   
+/* [] */
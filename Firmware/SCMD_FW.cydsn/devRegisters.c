@@ -18,33 +18,132 @@ Distributed as-is; no warranty is given.
 #include "devRegisters.h"
 #include "SCMD_config.h"
 #include "registerHandlers.h"
+#include "remoteAccess.h"
+#include "diagCounters.h"
+#include "accessStats.h"
+#include "configStore.h"
 
 //Set accessable table size here:
 #define REGISTER_TABLE_LENGTH 128
 
-//bits for access table
-#define UNSERVICED 0x01
+//Access classes
 #define GLOBAL_READ_ONLY 0x02
 #define USER_READ_ONLY 0x04
+#define REMOTE_STATIC 0x08
+#define NOT_TRACKED 0x10 //Changes too often to be worth reporting on SCMD_PAGE_CHANGES
 
 static uint8_t registerTable[REGISTER_TABLE_LENGTH];
-static uint8_t registerAccessTable[REGISTER_TABLE_LENGTH]; // b0: unserviced, b1: global read-only, b2: user read-only
-
-#define BB_INV_2_9             0x00000001
-#define BB_INV_10_17           0x00000002
-#define BB_INV_18_25           0x00000004
-#define BB_INV_26_33           0x00000008
-#define BB_BRIDGE_SLV_L        0x00000010
-#define BB_BRIDGE_SLV_H        0x00000020
-#define BB_DRIVER_ENABLE       0x00000040
-#define BB_FORCE_UPDATE        0x00000080
-#define BB_MASTER_LOCK         0x00000100
-#define BB_USER_LOCK           0x00000200
-#define BB_FSAFE_TIME          0x00000400
-#define BB_REM_WRITE           0x00000800
-#define BB_REM_READ            0x00001000
+//Changed by a write and not yet serviced, one bit per register
+static uint8_t unservicedBits[REGISTER_TABLE_LENGTH / 8];
+#define UNSERVICED_BIT(reg) ( 1 << ( (reg) & 0x07 ))
+
+//Access class of each register, fixed at build time
+static const uint8_t registerAccessClass[REGISTER_TABLE_LENGTH] =
+{
+    // Global read-only (unlock with master key), some are static once a slave is
+    // enumerated (master may cache remote reads)
+    [SCMD_FID] = GLOBAL_READ_ONLY | REMOTE_STATIC,
+    [SCMD_ID] = GLOBAL_READ_ONLY | REMOTE_STATIC,
+    [SCMD_SLAVE_ADDR] = GLOBAL_READ_ONLY | REMOTE_STATIC,
+    [SCMD_CONFIG_BITS] = GLOBAL_READ_ONLY | REMOTE_STATIC,
+    [SCMD_SLV_POLL_CNT] = GLOBAL_READ_ONLY,
+    [SCMD_SLV_TOP_ADDR] = GLOBAL_READ_ONLY,
+    [SCMD_REM_DATA_RD] = GLOBAL_READ_ONLY,
+    [SCMD_U_PORT_CLKDIV_U] = GLOBAL_READ_ONLY,
+    [SCMD_U_PORT_CLKDIV_L] = GLOBAL_READ_ONLY,
+    [SCMD_U_PORT_CLKDIV_CTRL] = GLOBAL_READ_ONLY,
+    [SCMD_E_PORT_CLKDIV_U] = GLOBAL_READ_ONLY,
+    [SCMD_E_PORT_CLKDIV_L] = GLOBAL_READ_ONLY,
+    [SCMD_E_PORT_CLKDIV_CTRL] = GLOBAL_READ_ONLY,
+    [SCMD_U_BUS_UART_BAUD] = GLOBAL_READ_ONLY,
+    [SCMD_GEN_TEST_WORD] = GLOBAL_READ_ONLY,
+    [SCMD_STATUS_1] = GLOBAL_READ_ONLY,
+    [SCMD_FRAME_TIME_L] = GLOBAL_READ_ONLY | NOT_TRACKED,
+    [SCMD_FRAME_TIME_H] = GLOBAL_READ_ONLY | NOT_TRACKED,
+    [SCMD_REMQ_ID] = GLOBAL_READ_ONLY,
+    [SCMD_REMQ_DONE] = GLOBAL_READ_ONLY,
+    [SCMD_REMQ_PENDING] = GLOBAL_READ_ONLY,
+    [SCMD_EVENT_FLAGS] = GLOBAL_READ_ONLY, //Host clears through writeUserRegister()
+    [SCMD_OP_SEQ] = GLOBAL_READ_ONLY,
+    [SCMD_OP_DONE] = GLOBAL_READ_ONLY,
+    [SCMD_PAGE_LEN] = GLOBAL_READ_ONLY | NOT_TRACKED,
+    [SCMD_CONFIG_STATUS] = GLOBAL_READ_ONLY,
+    
+    // User lockable (starts unlocked)
+    [SCMD_LOCAL_MASTER_LOCK] = USER_READ_ONLY,
+    [SCMD_MOTOR_A_INVERT] = USER_READ_ONLY,
+    [SCMD_MOTOR_B_INVERT] = USER_READ_ONLY,
+    [SCMD_BRIDGE] = USER_READ_ONLY,
+    [SCMD_INV_2_9] = USER_READ_ONLY,
+    [SCMD_INV_10_17] = USER_READ_ONLY,
+    [SCMD_INV_18_25] = USER_READ_ONLY,
+    [SCMD_INV_26_33] = USER_READ_ONLY,
+    [SCMD_BRIDGE_SLV_L] = USER_READ_ONLY,
+    [SCMD_BRIDGE_SLV_H] = USER_READ_ONLY,
+    [SCMD_FSAFE_TIME] = USER_READ_ONLY,
+    [SCMD_DRIVER_ENABLE] = USER_READ_ONLY,
+    [SCMD_UPDATE_RATE] = USER_READ_ONLY,
+    [SCMD_UPDATE_PERIOD_L] = USER_READ_ONLY,
+    [SCMD_UPDATE_PERIOD_H] = USER_READ_ONLY,
+    [SCMD_MASTER_LOCK] = USER_READ_ONLY,
+    [SCMD_E_BUS_SPEED] = USER_READ_ONLY,
+    [SCMD_CONTROL_1] = USER_READ_ONLY,
+    [SCMD_FSAFE_CTRL] = USER_READ_ONLY,
+    [SCMD_MST_BG_CTRL] = USER_READ_ONLY,
+    
+    // Not lockable
+    [SCMD_MST_E_STATUS] = NOT_TRACKED, //Every expansion transfer
+    [SCMD_PAGE_SELECT] = NOT_TRACKED, //Host's own paging
+};
+
+//Access classes writes are refused for under the current keys.  Only changes
+//when SCMD_LOCAL_USER_LOCK or SCMD_LOCAL_MASTER_LOCK are written.
+static uint8_t writeDenyMask = GLOBAL_READ_ONLY | USER_READ_ONLY;
+static void updateWriteMask( void );
+
+//Host change tracking, mapped as SCMD_PAGE_CHANGES.  Separate from the unserviced
+//bits, which the firmware's handlers clear -- these are only cleared by the host.
+static uint8_t changeTable[SCMD_CHG_LENGTH];
+
+//Pages other than 0 are owned by other modules and mapped in with mapRegisterPage()
+typedef struct
+{
+    uint8_t * data;
+    uint8_t length;
+    bool writable;
+} registerPage_t;
+
+static registerPage_t registerPages[REGISTER_PAGE_COUNT];
+//Resolved when SCMD_PAGE_SELECT is written so paged accesses don't look it up, 0 for page 0
+static registerPage_t * selectedPage = 0;
+static void selectRegisterPage( void );
+static void writeExtSlaveRegister( uint8_t offset, uint8_t dataToWrite );
+
+//Slaves 17 and up don't fit the register table, their settings live on SCMD_PAGE_EXT_SLAVES
+static uint8_t extSlaveTable[SCMD_EXT_LENGTH];
+static uint8_t extSlaveShadow[SCMD_EXT_LENGTH - SCMD_EXT_INV]; //Last inversion/bridging sent
+#define EXT_MOTOR_COUNT (SCMD_EXT_INV - SCMD_EXT_DRIVE)
+
+//Access class of each extended slave register, same classes as page 0.  Inversion
+//and bridging lock with SCMD_USER_LOCK like SCMD_INV_* and SCMD_BRIDGE_SLV_*.
+static const uint8_t extSlaveAccessClass[SCMD_EXT_LENGTH] =
+{
+    [SCMD_EXT_INV] = USER_READ_ONLY,
+    [SCMD_EXT_INV + 1] = USER_READ_ONLY,
+    [SCMD_EXT_INV + 2] = USER_READ_ONLY,
+    [SCMD_EXT_INV + 3] = USER_READ_ONLY,
+    [SCMD_EXT_BRIDGE] = USER_READ_ONLY,
+    [SCMD_EXT_BRIDGE + 1] = USER_READ_ONLY,
+};
+
+//Async operations, one busyBitMemory bit each (see busyBitIndex())
+#define BB_COUNT               15
+#define BB_EXT_SLAVES          14 //Any extended inversion/bridging write
+#define BB_NONE                0xFF
 
 volatile uint32_t busyBitMemory = 0;
+//SCMD_OP_SEQ value each pending operation was issued with
+static uint8_t busySeq[BB_COUNT];
 
 void initDevRegisters( void )
 {
@@ -53,52 +152,22 @@ void initDevRegisters( void )
     for( i = 0; i < REGISTER_TABLE_LENGTH; i++ )
     {
         registerTable[i] = 0x00;
-        registerAccessTable[i] = 0x00;
+    }
+    for( i = 0; i < REGISTER_TABLE_LENGTH / 8; i++ )
+    {
+        unservicedBits[i] = 0x00;
     }
     
-    //Define register lockable states:
-	// Global read-only (unlock with master key)
-    registerAccessTable[SCMD_FID] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_ID] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_SLAVE_ADDR] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_CONFIG_BITS] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_SLV_POLL_CNT] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_SLV_TOP_ADDR] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_REM_DATA_RD] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_U_PORT_CLKDIV_U] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_U_PORT_CLKDIV_L] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_U_PORT_CLKDIV_CTRL] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_E_PORT_CLKDIV_U] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_E_PORT_CLKDIV_L] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_E_PORT_CLKDIV_CTRL] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_U_BUS_UART_BAUD] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_GEN_TEST_WORD] = GLOBAL_READ_ONLY;
-    registerAccessTable[SCMD_STATUS_1] = GLOBAL_READ_ONLY;
-	
-	// User lockable (starts unlocked)
-    registerAccessTable[SCMD_LOCAL_MASTER_LOCK] = USER_READ_ONLY;
-    registerAccessTable[SCMD_MOTOR_A_INVERT] = USER_READ_ONLY;
-    registerAccessTable[SCMD_MOTOR_B_INVERT] = USER_READ_ONLY;
-    registerAccessTable[SCMD_BRIDGE] = USER_READ_ONLY;
-    registerAccessTable[SCMD_INV_2_9] = USER_READ_ONLY;
-    registerAccessTable[SCMD_INV_10_17] = USER_READ_ONLY;
-    registerAccessTable[SCMD_INV_18_25] = USER_READ_ONLY;
-    registerAccessTable[SCMD_INV_26_33] = USER_READ_ONLY;
-    registerAccessTable[SCMD_BRIDGE_SLV_L] = USER_READ_ONLY;
-    registerAccessTable[SCMD_BRIDGE_SLV_H] = USER_READ_ONLY;
-    registerAccessTable[SCMD_FSAFE_TIME] = USER_READ_ONLY;
-    registerAccessTable[SCMD_DRIVER_ENABLE] = USER_READ_ONLY;
-    registerAccessTable[SCMD_UPDATE_RATE] = USER_READ_ONLY;
-    registerAccessTable[SCMD_MASTER_LOCK] = USER_READ_ONLY;
-    registerAccessTable[SCMD_E_BUS_SPEED] = USER_READ_ONLY;
-    registerAccessTable[SCMD_CONTROL_1] = USER_READ_ONLY;
-    registerAccessTable[SCMD_FSAFE_CTRL] = USER_READ_ONLY;
+    mapRegisterPage( SCMD_PAGE_EXT_SLAVES, extSlaveTable, SCMD_EXT_LENGTH, true );
+    mapRegisterPage( SCMD_PAGE_CHANGES, changeTable, SCMD_CHG_LENGTH, false );
     
     setColdInitValues();
+    selectRegisterPage();
 }
 
 void setColdInitValues( void )
 {
+    uint8_t i;
     //Set hardcoded initial values --
     //ID_WORD, START_SLAVE_ADDR, MAX_SLAVE_ADDR are defined within the included files
     // (writing straight to the table forgos 'isChanged' check)
@@ -106,6 +175,7 @@ void setColdInitValues( void )
     registerTable[SCMD_LOCAL_USER_LOCK] = USER_LOCK_KEY;  //Start unlocked
     registerTable[SCMD_MASTER_LOCK] = MASTER_LOCK_KEY;  //Start unlocked
     registerTable[SCMD_USER_LOCK] = USER_LOCK_KEY;  //Start unlocked
+    updateWriteMask();
     
 	writeDevRegister(SCMD_FID, FIRMWARE_VERSION);
     writeDevRegister(SCMD_ID, ID_WORD);
@@ -123,12 +193,19 @@ void setColdInitValues( void )
     registerTable[SCMD_E_BUS_SPEED] = 0x01;
     registerTable[SCMD_FSAFE_CTRL] = (SCMD_FSAFE_CYCLE_EXP | SCMD_FSAFE_CYCLE_USER | SCMD_FSAFE_DRIVE_KILL); //Mode reinit both ports, stop motors
     writeDevRegister(SCMD_MST_E_IN_FN, SCMD_M_IN_CYCLE_USER | SCMD_M_IN_CYCLE_EXP);
+    registerTable[SCMD_MST_BG_CTRL] = SCMD_BG_TELEMETRY_EN | SCMD_BG_HOTPLUG_EN;
+    for( i = SCMD_EXT_INV; i < SCMD_EXT_LENGTH; i++ )
+    {
+        extSlaveTable[i] = 0;
+        extSlaveShadow[i - SCMD_EXT_INV] = 0;
+    }
     
     setWarmInitValues();
 }
 
 void setWarmInitValues( void )
 {
+    uint8_t i;
     writeDevRegister(SCMD_MA_DRIVE, 0x80);
     writeDevRegister(SCMD_MB_DRIVE, 0x80);
     writeDevRegister(SCMD_S1A_DRIVE, 0x80);
@@ -163,6 +240,10 @@ void setWarmInitValues( void )
     writeDevRegister(SCMD_S15B_DRIVE, 0x80);
     writeDevRegister(SCMD_S16A_DRIVE, 0x80);
     writeDevRegister(SCMD_S16B_DRIVE, 0x80);    
+    for( i = SCMD_EXT_DRIVE; i < SCMD_EXT_INV; i++ )
+    {
+        extSlaveTable[i] = 0x80;
+    }
 }
 
 uint8_t readDevRegister( uint8_t regNumberIn )
@@ -178,71 +259,116 @@ uint8_t readDevRegister( uint8_t regNumberIn )
     }
 }
 
+//Fill a buffer from consecutive registers.  Only the first location counts as
+//an access, the rest are read ahead and pad with 0 past the end of the table.
+void readDevRegisterBurst( uint8_t regNumberIn, uint8_t * buffer, uint8_t count )
+{
+    uint8_t i;
+    if( count == 0 ) return;
+    buffer[0] = readDevRegister( regNumberIn );
+    for( i = 1; i < count; i++ )
+    {
+        uint16_t regTemp = regNumberIn + i;
+        if( regTemp < REGISTER_TABLE_LENGTH )
+        {
+            buffer[i] = registerTable[regTemp];
+        }
+        else
+        {
+            buffer[i] = 0;
+        }
+    }
+}
+
+//Recompute writeDenyMask from the local keys
+static void updateWriteMask( void )
+{
+    if( registerTable[SCMD_LOCAL_MASTER_LOCK] == MASTER_LOCK_KEY )
+    {
+        writeDenyMask = 0;
+    }
+    else if( registerTable[SCMD_LOCAL_USER_LOCK] == USER_LOCK_KEY )
+    {
+        writeDenyMask = GLOBAL_READ_ONLY;
+    }
+    else
+    {
+        writeDenyMask = GLOBAL_READ_ONLY | USER_READ_ONLY;
+    }
+}
+
+//Bump the generation and set the register's changed bit, regNumberIn must be in range
+static void noteRegisterChange( uint8_t regNumberIn )
+{
+    uint8_t interruptState;
+    uint16_t generation;
+    if( registerAccessClass[regNumberIn] & NOT_TRACKED ) return;
+    //Written from both ISRs and the main loop
+    interruptState = CyEnterCriticalSection();
+    generation = changeTable[SCMD_CHG_GEN_L] | ( changeTable[SCMD_CHG_GEN_H] << 8 );
+    generation++;
+    changeTable[SCMD_CHG_GEN_L] = generation & 0xFF;
+    changeTable[SCMD_CHG_GEN_H] = generation >> 8;
+    changeTable[SCMD_CHG_BITMAP + ( regNumberIn >> 3 )] |= 1 << ( regNumberIn & 0x07 );
+    CyExitCriticalSection( interruptState );
+}
+
+//Table write that reports real changes, regNumberIn must be in range
+static void setTableValue( uint8_t regNumberIn, uint8_t dataToWrite )
+{
+    if( registerTable[regNumberIn] != dataToWrite )
+    {
+        registerTable[regNumberIn] = dataToWrite;
+        noteRegisterChange( regNumberIn );
+    }
+}
+
+//Store and flag for service, regNumberIn must be in range
+static void storeDevRegister( uint8_t regNumberIn, uint8_t dataToWrite )
+{
+    setTableValue( regNumberIn, dataToWrite );
+    unservicedBits[regNumberIn >> 3] |= UNSERVICED_BIT( regNumberIn );
+    //*** TEMP CODE ***//
+    setBusyBitMem( regNumberIn );
+    if(busyBitMemory)
+    {
+        setStatusBit(SCMD_BUSY_BIT);
+    }
+    //*** TEMP CODE ***//
+    if(( regNumberIn == SCMD_LOCAL_MASTER_LOCK )||( regNumberIn == SCMD_LOCAL_USER_LOCK ))
+    {
+        updateWriteMask();
+    }
+}
+
+//Write subject to the register's access class and the current keys
 void writeDevRegister( uint8_t regNumberIn, uint8_t dataToWrite )
 {
     if( regNumberIn >= REGISTER_TABLE_LENGTH )
     {
         incrementDevRegister( SCMD_REG_OOR_CNT );
     }
+    else if( registerAccessClass[regNumberIn] & writeDenyMask )
+    {
+        //Locked -- no access
+        incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
+    }
     else
     {
-        if(registerAccessTable[regNumberIn] & USER_READ_ONLY)
-        {
-            //Register is user lockable
-            if((registerTable[SCMD_LOCAL_USER_LOCK] == USER_LOCK_KEY)||(registerTable[SCMD_LOCAL_MASTER_LOCK] == MASTER_LOCK_KEY)) //check if either key is in
-            {
-                //Unlocked
-                registerTable[regNumberIn] = dataToWrite;
-                //*** TEMP CODE ***//
-                setBusyBitMem( regNumberIn );
-                if(busyBitMemory)
-                {
-                    setStatusBit(SCMD_BUSY_BIT);
-                }
-                //*** TEMP CODE ***//
-                registerAccessTable[regNumberIn] |= UNSERVICED; //set bit
-            }
-            else
-            {
-                //Locked -- no access
-                incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
-            }
-        }
-        else if(registerAccessTable[regNumberIn] & GLOBAL_READ_ONLY)
-        {
-            //Register is user lockable
-            if(registerTable[SCMD_LOCAL_MASTER_LOCK] == MASTER_LOCK_KEY)
-            {
-                //Unlocked
-                registerTable[regNumberIn] = dataToWrite;
-                //*** TEMP CODE ***//
-                setBusyBitMem( regNumberIn );
-                if(busyBitMemory)
-                {
-                    setStatusBit(SCMD_BUSY_BIT);
-                }
-                //*** TEMP CODE ***//
-                registerAccessTable[regNumberIn] |= UNSERVICED; //set bit
-            }
-            else
-            {
-                //Locked -- no access
-                incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
-            }
-        }
-        else
-        {
-            //Fully unlocked register
-            registerTable[regNumberIn] = dataToWrite;
-            registerAccessTable[regNumberIn] |= UNSERVICED; //set bit
-            //*** TEMP CODE ***//
-            setBusyBitMem( regNumberIn );
-            if(busyBitMemory)
-            {
-                setStatusBit(SCMD_BUSY_BIT);
-            }
-            //*** TEMP CODE ***//
-        }
+        storeDevRegister( regNumberIn, dataToWrite );
+    }
+}
+
+//Firmware's own writes, no lock check but otherwise the same as writeDevRegister()
+void writeDevRegisterInternal( uint8_t regNumberIn, uint8_t dataToWrite )
+{
+    if( regNumberIn >= REGISTER_TABLE_LENGTH )
+    {
+        incrementDevRegister( SCMD_REG_OOR_CNT );
+    }
+    else
+    {
+        storeDevRegister( regNumberIn, dataToWrite );
     }
 }
 
@@ -254,7 +380,7 @@ void writeDevRegisterUnprotected( uint8_t regNumberIn, uint8_t dataToWrite )
     }
     else
     {
-        registerTable[regNumberIn] = dataToWrite;
+        setTableValue( regNumberIn, dataToWrite );
     }
 }
 
@@ -263,45 +389,19 @@ void incrementDevRegister( uint8_t regNumberIn )
     if( regNumberIn >= REGISTER_TABLE_LENGTH )
     {
         incrementDevRegister( SCMD_REG_OOR_CNT );
+        return;
+    }
+    countDiagEvent( regNumberIn ); //Wide copy counts even if the register is locked
+    if( registerAccessClass[regNumberIn] & writeDenyMask )
+    {
+        //Locked -- no access
+        incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
     }
     else
     {
-        if(registerAccessTable[regNumberIn] & USER_READ_ONLY)
-        {
-            //Register is user lockable
-            if((registerTable[SCMD_LOCAL_USER_LOCK] == USER_LOCK_KEY)||(registerTable[SCMD_LOCAL_MASTER_LOCK] == MASTER_LOCK_KEY)) //check if either key is in
-            {
-                //Unlocked
-                registerTable[regNumberIn]++;
-                registerAccessTable[regNumberIn] |= UNSERVICED; //set bit
-            }
-            else
-            {
-                //Locked -- no access
-                incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
-            }
-        }
-        else if(registerAccessTable[regNumberIn] & GLOBAL_READ_ONLY)
-        {
-            //Register is user lockable
-            if(registerTable[SCMD_LOCAL_MASTER_LOCK] == MASTER_LOCK_KEY)
-            {
-                //Unlocked
-                registerTable[regNumberIn]++;
-                registerAccessTable[regNumberIn] |= UNSERVICED; //set bit
-            }
-            else
-            {
-                //Locked -- no access
-                incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
-            }
-        }
-        else
-        {
-            //Fully unlocked register
-            registerTable[regNumberIn]++;
-            registerAccessTable[regNumberIn] |= UNSERVICED; //set bit
-        }
+        registerTable[regNumberIn]++;
+        unservicedBits[regNumberIn >> 3] |= UNSERVICED_BIT( regNumberIn );
+        noteRegisterChange( regNumberIn );
     }
 }
 
@@ -314,10 +414,31 @@ bool getChangedStatus( uint8_t regNumberIn )
     }
     else
     {
-        return registerAccessTable[regNumberIn] & UNSERVICED; //set bit
+        return ( unservicedBits[regNumberIn >> 3] & UNSERVICED_BIT( regNumberIn )) != 0;
     }
 }
 
+bool getStaticStatus( uint8_t regNumberIn )
+{
+    if( regNumberIn >= REGISTER_TABLE_LENGTH )
+    {
+        return false;
+    }
+    else
+    {
+        return registerAccessClass[regNumberIn] & REMOTE_STATIC;
+    }
+}
+
+bool getWritableStatus( uint8_t regNumberIn )
+{
+    if( regNumberIn >= REGISTER_TABLE_LENGTH )
+    {
+        return false;
+    }
+    return ( registerAccessClass[regNumberIn] & writeDenyMask ) == 0;
+}
+
 void clearChangedStatus( uint8_t regNumberIn )
 {
     if( regNumberIn >= REGISTER_TABLE_LENGTH )
@@ -326,101 +447,443 @@ void clearChangedStatus( uint8_t regNumberIn )
     }
     else
     {
-        registerAccessTable[regNumberIn] &= ~UNSERVICED; //clear bit
+        unservicedBits[regNumberIn >> 3] &= ~UNSERVICED_BIT( regNumberIn ); //clear bit
     }
 }
 
-void setBusyBitMem( uint8_t offset )// Send register value
+//Bit in busyBitMemory for registers that start an async operation
+static uint8_t busyBitIndex( uint8_t offset )
 {
     switch(offset)
     {
-        case SCMD_INV_2_9:
-        busyBitMemory |= BB_INV_2_9;
-        break;
-        case SCMD_INV_10_17:
-        busyBitMemory |= BB_INV_10_17;
-        break;
-        case SCMD_INV_18_25:
-        busyBitMemory |= BB_INV_18_25;
-        break;
-        case SCMD_INV_26_33:
-        busyBitMemory |= BB_INV_26_33;
-        break;
-        case SCMD_BRIDGE_SLV_L:
-        busyBitMemory |= BB_BRIDGE_SLV_L;
-        break;
-        case SCMD_BRIDGE_SLV_H:
-        busyBitMemory |= BB_BRIDGE_SLV_H;
-        break;
-        case SCMD_DRIVER_ENABLE:
-        busyBitMemory |= BB_DRIVER_ENABLE;
-        break;
-        case SCMD_FORCE_UPDATE:
-        busyBitMemory |= BB_FORCE_UPDATE;
-        break;
-        case SCMD_MASTER_LOCK:
-        busyBitMemory |= BB_MASTER_LOCK;
-        break;
-        case SCMD_USER_LOCK:
-        busyBitMemory |= BB_USER_LOCK;
-        break;
-        case SCMD_FSAFE_TIME:
-        busyBitMemory |= BB_FSAFE_TIME;
-        break;
-        case SCMD_REM_WRITE:
-        busyBitMemory |= BB_REM_WRITE;
-        break;
-        case SCMD_REM_READ:
-        busyBitMemory |= BB_REM_READ;
-        default:
-        break;
+        case SCMD_INV_2_9: return 0;
+        case SCMD_INV_10_17: return 1;
+        case SCMD_INV_18_25: return 2;
+        case SCMD_INV_26_33: return 3;
+        case SCMD_BRIDGE_SLV_L: return 4;
+        case SCMD_BRIDGE_SLV_H: return 5;
+        case SCMD_DRIVER_ENABLE: return 6;
+        case SCMD_FORCE_UPDATE: return 7;
+        case SCMD_MASTER_LOCK: return 8;
+        case SCMD_USER_LOCK: return 9;
+        case SCMD_FSAFE_TIME: return 10;
+        case SCMD_REM_WRITE: return 11;
+        case SCMD_REM_READ: return 12;
+        case SCMD_REM_BLK_OP: return 13;
+        default: return BB_NONE;
     }
 }
 
+//SCMD_OP_DONE is the newest sequence with nothing older still pending, so a host
+//waiting for one op never sees it done before something it was queued behind.
+static void updateOpDone( void )
+{
+    uint8_t i;
+    uint8_t behind = 0;
+    for( i = 0; i < BB_COUNT; i++ )
+    {
+        if(( busyBitMemory & ( 1ul << i ))&&( (uint8_t)( registerTable[SCMD_OP_SEQ] - busySeq[i] + 1 ) > behind ))
+        {
+            behind = registerTable[SCMD_OP_SEQ] - busySeq[i] + 1;
+        }
+    }
+    setTableValue( SCMD_OP_DONE, registerTable[SCMD_OP_SEQ] - behind );
+}
+
+//Each write to an async register gets the next SCMD_OP_SEQ.  A second write before
+//the first is serviced merges into it, keeping the older number so neither reads
+//as done until the register has been serviced.
+//
+//Host writes set bits from the user port ISR and the main loop clears them, so
+//the bits, the sequence and SCMD_OP_DONE are only changed in a critical section.
+static void setBusyBitIndex( uint8_t index )
+{
+    uint8_t interruptState;
+    if( index == BB_NONE ) return;
+    interruptState = CyEnterCriticalSection();
+    setTableValue( SCMD_OP_SEQ, registerTable[SCMD_OP_SEQ] + 1 );
+    if(( busyBitMemory & ( 1ul << index )) == 0 )
+    {
+        busySeq[index] = registerTable[SCMD_OP_SEQ];
+    }
+    busyBitMemory |= 1ul << index;
+    updateOpDone();
+    CyExitCriticalSection( interruptState );
+}
+
+static void clearBusyBitIndex( uint8_t index )
+{
+    uint8_t interruptState;
+    if( index == BB_NONE ) return;
+    interruptState = CyEnterCriticalSection();
+    busyBitMemory &= ~( 1ul << index );
+    updateOpDone();
+    CyExitCriticalSection( interruptState );
+}
+
+void setBusyBitMem( uint8_t offset )// Send register value
+{
+    setBusyBitIndex( busyBitIndex( offset ) );
+}
+
 void clearBusyBitMem( uint8_t offset )// Send register value
 {
-    switch(offset)
+    clearBusyBitIndex( busyBitIndex( offset ) );
+}
+
+//Drop everything in progress, all issued sequences read as done
+void clearAllBusyBitMem( void )
+{
+    uint8_t interruptState = CyEnterCriticalSection();
+    busyBitMemory = 0;
+    updateOpDone();
+    CyExitCriticalSection( interruptState );
+}
+
+void mapRegisterPage( uint8_t page, uint8_t * data, uint8_t length, bool writable )
+{
+    if(( page == 0 )||( page >= REGISTER_PAGE_COUNT ))
+    {
+        return;
+    }
+    if( length > SCMD_PAGE_LENGTH )
+    {
+        length = SCMD_PAGE_LENGTH;
+    }
+    registerPages[page].data = data;
+    registerPages[page].length = length;
+    registerPages[page].writable = writable;
+    selectRegisterPage();
+}
+
+//Resolve SCMD_PAGE_SELECT and report the page's length in SCMD_PAGE_LEN
+static void selectRegisterPage( void )
+{
+    uint8_t page = registerTable[SCMD_PAGE_SELECT];
+    if( page == 0 )
+    {
+        selectedPage = 0;
+        registerTable[SCMD_PAGE_LEN] = SCMD_PAGE_LENGTH;
+    }
+    else if(( page >= REGISTER_PAGE_COUNT )||( registerPages[page].data == 0 ))
+    {
+        selectedPage = &registerPages[0]; //Unmapped, length 0
+        registerTable[SCMD_PAGE_LEN] = 0;
+    }
+    else
+    {
+        selectedPage = &registerPages[page];
+        registerTable[SCMD_PAGE_LEN] = registerPages[page].length;
+    }
+}
+
+//Returns a pointer to the paged location, or 0 if it's on page 0 or the common area
+static registerPage_t * getSelectedPage( uint8_t regNumberIn )
+{
+    if( regNumberIn >= SCMD_PAGE_LENGTH )
+    {
+        return 0;
+    }
+    return selectedPage;
+}
+
+uint8_t readUserRegister( uint8_t regNumberIn )
+{
+    registerPage_t * page = getSelectedPage( regNumberIn );
+    if( page == 0 )
+    {
+#ifdef REGISTER_ACCESS_STATS
+        countRegisterAccess( regNumberIn, false );
+#endif
+        return readDevRegister( regNumberIn );
+    }
+    if( regNumberIn >= page->length )
+    {
+#ifdef REGISTER_ACCESS_STATS
+        markRefusedAccess( regNumberIn );
+#endif
+        incrementDevRegister( SCMD_REG_OOR_CNT );
+        return 0;
+    }
+    return page->data[regNumberIn];
+}
+
+void writeUserRegister( uint8_t regNumberIn, uint8_t dataToWrite )
+{
+    registerPage_t * page = getSelectedPage( regNumberIn );
+    if( page == 0 )
+    {
+#ifdef REGISTER_ACCESS_STATS
+        countRegisterAccess( regNumberIn, true );
+        if(( regNumberIn < REGISTER_TABLE_LENGTH )&&( registerAccessClass[regNumberIn] & writeDenyMask )&&( regNumberIn != SCMD_EVENT_FLAGS ))
+        {
+            markRefusedAccess( regNumberIn );
+        }
+#endif
+        if( regNumberIn == SCMD_EVENT_FLAGS )
+        {
+            //Write 1s to clear, raiseEvent() can run from the failsafe ISR
+            uint8_t interruptState = CyEnterCriticalSection();
+            writeDevRegisterUnprotected( SCMD_EVENT_FLAGS, registerTable[SCMD_EVENT_FLAGS] & ~dataToWrite );
+            updateHostAlert();
+            CyExitCriticalSection( interruptState );
+            return;
+        }
+        if( regNumberIn == SCMD_DIAG_LATCH )
+        {
+            //Handled now so a following burst read sees the snapshot
+            latchDiagCounters( dataToWrite );
+            return;
+        }
+        writeDevRegister( regNumberIn, dataToWrite );
+        //Queue pushes happen now rather than in the main loop so bursts can stack ops
+        if( regNumberIn == SCMD_REMQ_OP )
+        {
+            pushRemoteOperation();
+        }
+        if( regNumberIn == SCMD_EVENT_MASK )
+        {
+            updateHostAlert();
+        }
+        if( regNumberIn == SCMD_PAGE_SELECT )
+        {
+            selectRegisterPage();
+        }
+        return;
+    }
+#ifdef REGISTER_ACCESS_STATS
+    if(( page == &registerPages[SCMD_PAGE_ACCESS_STATS] )&&( regNumberIn == SCMD_AST_CTRL ))
+    {
+        accessStatsControl( dataToWrite );
+        return;
+    }
+    if(( regNumberIn >= page->length )||(( page->writable == false )&&( page != &registerPages[SCMD_PAGE_CHANGES] ))
+        ||(( page == &registerPages[SCMD_PAGE_EXT_SLAVES] )&&( extSlaveAccessClass[regNumberIn] & writeDenyMask )))
+    {
+        markRefusedAccess( regNumberIn );
+    }
+#endif
+    if( regNumberIn >= page->length )
+    {
+        incrementDevRegister( SCMD_REG_OOR_CNT );
+    }
+    else if(( page == &registerPages[SCMD_PAGE_CONFIG_BLOB] )&&( regNumberIn == SCMD_BLOB_CTRL ))
+    {
+        configBlobControl( dataToWrite );
+    }
+    else if(( page == &registerPages[SCMD_PAGE_CHANGES] )&&( regNumberIn >= SCMD_CHG_BITMAP ))
+    {
+        //Write 1s to acknowledge
+        uint8_t interruptState = CyEnterCriticalSection();
+        changeTable[regNumberIn] &= ~dataToWrite;
+        CyExitCriticalSection( interruptState );
+    }
+    else if( page == &registerPages[SCMD_PAGE_EXT_SLAVES] )
+    {
+        writeExtSlaveRegister( regNumberIn, dataToWrite );
+    }
+    else if( page->writable == false )
+    {
+        incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
+    }
+    else
+    {
+        page->data[regNumberIn] = dataToWrite;
+    }
+}
+
+//Fill a buffer from consecutive registers.  Only the first location counts as
+//an access, the rest are read ahead and silently pad with 0 past the end.
+void readUserRegisterBurst( uint8_t regNumberIn, uint8_t * buffer, uint8_t count )
+{
+    uint8_t i;
+    if( count == 0 ) return;
+    buffer[0] = readUserRegister( regNumberIn );
+    for( i = 1; i < count; i++ )
+    {
+        uint16_t regTemp = regNumberIn + i;
+        registerPage_t * page = getSelectedPage( regTemp );
+        if( regTemp >= REGISTER_TABLE_LENGTH )
+        {
+            buffer[i] = 0;
+        }
+        else if( page == 0 )
+        {
+            buffer[i] = registerTable[regTemp];
+        }
+        else if( regTemp < page->length )
+        {
+            buffer[i] = page->data[regTemp];
+        }
+        else
+        {
+            buffer[i] = 0;
+        }
+    }
+}
+
+//Write consecutive registers.  Writes past SCMD_REMQ_OP wrap to SCMD_REMQ_ADDR so a
+//burst can push many queued ops.  An I2C write starting at SCMD_PAGE_SELECT is a
+//page switch, not a burst (see SCMD_config.h), and gets here from its offset on.
+void writeUserRegisterBurst( uint8_t regNumberIn, uint8_t * buffer, uint8_t count )
+{
+    uint8_t i;
+    for( i = 0; i < count; i++ )
     {
-        case SCMD_INV_2_9:
-        busyBitMemory &= ~( BB_INV_2_9 );
-        break;
-        case SCMD_INV_10_17:
-        busyBitMemory &= ~( BB_INV_10_17 );
-        break;
-        case SCMD_INV_18_25:
-        busyBitMemory &= ~( BB_INV_18_25 );
-        break;
-        case SCMD_INV_26_33:
-        busyBitMemory &= ~( BB_INV_26_33 );
-        break;
-        case SCMD_BRIDGE_SLV_L:
-        busyBitMemory &= ~( BB_BRIDGE_SLV_L );
-        break;
-        case SCMD_BRIDGE_SLV_H:
-        busyBitMemory &= ~( BB_BRIDGE_SLV_H );
-        break;
-        case SCMD_DRIVER_ENABLE:
-        busyBitMemory &= ~( BB_DRIVER_ENABLE );
-        break;
-        case SCMD_FORCE_UPDATE:
-        busyBitMemory &= ~( BB_FORCE_UPDATE );
-        break;
-        case SCMD_MASTER_LOCK:
-        busyBitMemory &= ~( BB_MASTER_LOCK );
-        break;
-        case SCMD_USER_LOCK:
-        busyBitMemory &= ~( BB_USER_LOCK );
-        break;
-        case SCMD_FSAFE_TIME:
-        busyBitMemory &= ~( BB_FSAFE_TIME );
-        break;
-        case SCMD_REM_WRITE:
-        busyBitMemory &= ~( BB_REM_WRITE );
-        break;
-        case SCMD_REM_READ:
-        busyBitMemory &= ~( BB_REM_READ );
-        break;
-        default:
-        break;
-    }
-}
\ No newline at end of file
+        writeUserRegister( regNumberIn, buffer[i] );
+        if(( regNumberIn == SCMD_REMQ_OP )&&( getSelectedPage( regNumberIn ) == 0 ))
+        {
+            regNumberIn = SCMD_REMQ_ADDR;
+        }
+        else if( regNumberIn < 0xFF ) //Hang at the top, counts OOR
+        {
+            regNumberIn++;
+        }
+    }
+}
+
+//****************************************************************************//
+//
+//  Motor and slave settings by number
+//
+//  Motors 0 to 33 (master and slaves 1 to 16) are in the register table, motors
+//  from SCMD_EXT_FIRST_MOTOR are on SCMD_PAGE_EXT_SLAVES.  Slave index 0 is the
+//  slave at START_SLAVE_ADDR.
+//
+//****************************************************************************//
+uint8_t readMotorDrive( uint8_t motorNum )
+{
+    if( motorNum < SCMD_EXT_FIRST_MOTOR )
+    {
+        return registerTable[SCMD_MA_DRIVE + motorNum];
+    }
+    return extSlaveTable[SCMD_EXT_DRIVE + motorNum - SCMD_EXT_FIRST_MOTOR];
+}
+
+void writeMotorDrive( uint8_t motorNum, uint8_t dataToWrite )
+{
+    if( motorNum < SCMD_EXT_FIRST_MOTOR )
+    {
+        writeDevRegister( SCMD_MA_DRIVE + motorNum, dataToWrite );
+    }
+    else if( motorNum < SCMD_EXT_FIRST_MOTOR + EXT_MOTOR_COUNT )
+    {
+        extSlaveTable[SCMD_EXT_DRIVE + motorNum - SCMD_EXT_FIRST_MOTOR] = dataToWrite;
+    }
+}
+
+//Inversion of a slave motor (motor 2 and up), 0 or 1
+uint8_t readMotorInvert( uint8_t motorNum )
+{
+    if( motorNum < SCMD_EXT_FIRST_MOTOR )
+    {
+        motorNum -= 2;
+        return ( registerTable[SCMD_INV_2_9 + (motorNum >> 3)] >> (motorNum & 0x07) ) & 0x01;
+    }
+    motorNum -= SCMD_EXT_FIRST_MOTOR;
+    return ( extSlaveTable[SCMD_EXT_INV + (motorNum >> 3)] >> (motorNum & 0x07) ) & 0x01;
+}
+
+void writeMotorInvert( uint8_t motorNum, uint8_t inverted )
+{
+    uint8_t regNumber;
+    uint8_t dataTemp;
+    if( motorNum < SCMD_EXT_FIRST_MOTOR )
+    {
+        motorNum -= 2;
+        regNumber = SCMD_INV_2_9 + (motorNum >> 3);
+        dataTemp = registerTable[regNumber] & ~(0x01 << (motorNum & 0x07));
+        writeDevRegister( regNumber, dataTemp | ((inverted & 0x01) << (motorNum & 0x07)) );
+    }
+    else if( motorNum < SCMD_EXT_FIRST_MOTOR + EXT_MOTOR_COUNT )
+    {
+        motorNum -= SCMD_EXT_FIRST_MOTOR;
+        dataTemp = extSlaveTable[SCMD_EXT_INV + (motorNum >> 3)] & ~(0x01 << (motorNum & 0x07));
+        extSlaveTable[SCMD_EXT_INV + (motorNum >> 3)] = dataTemp | ((inverted & 0x01) << (motorNum & 0x07));
+    }
+}
+
+uint8_t readSlaveBridge( uint8_t slaveIndex )
+{
+    uint8_t extIndex = SCMD_EXT_SLAVE_ADDR - START_SLAVE_ADDR;
+    if( slaveIndex < extIndex )
+    {
+        return ( registerTable[SCMD_BRIDGE_SLV_L + (slaveIndex >> 3)] >> (slaveIndex & 0x07) ) & 0x01;
+    }
+    slaveIndex -= extIndex;
+    return ( extSlaveTable[SCMD_EXT_BRIDGE + (slaveIndex >> 3)] >> (slaveIndex & 0x07) ) & 0x01;
+}
+
+//Host writes to the extended slave page, checked against the current keys like
+//writeDevRegister().  Inversion and bridging writes are async ops (BB_EXT_SLAVES),
+//finished with clearExtSlaveBusy() once the master has sent them.
+static void writeExtSlaveRegister( uint8_t offset, uint8_t dataToWrite )
+{
+    if( extSlaveAccessClass[offset] & writeDenyMask )
+    {
+        //Locked -- no access
+        incrementDevRegister( SCMD_REG_RO_WRITE_CNT );
+        return;
+    }
+    extSlaveTable[offset] = dataToWrite;
+    if( offset >= SCMD_EXT_INV )
+    {
+        setBusyBitIndex( BB_EXT_SLAVES );
+        setStatusBit( SCMD_BUSY_BIT );
+    }
+}
+
+bool getExtSlaveWritableStatus( uint8_t offset )
+{
+    if( offset >= SCMD_EXT_LENGTH )
+    {
+        return false;
+    }
+    return ( extSlaveAccessClass[offset] & writeDenyMask ) == 0;
+}
+
+void clearExtSlaveBusy( void )
+{
+    clearBusyBitIndex( BB_EXT_SLAVES );
+}
+
+//Paged writes don't set changed flags, so the master polls this.  Returns true once
+//per change of extended inversion or bridging, or while a host write of them is
+//waiting to be sent (a write of the same value still has to complete).
+bool getExtSlaveChanged( void )
+{
+    bool returnVar = ( busyBitMemory & ( 1ul << BB_EXT_SLAVES )) != 0;
+    uint8_t i;
+    for( i = SCMD_EXT_INV; i < SCMD_EXT_LENGTH; i++ )
+    {
+        if( extSlaveTable[i] != extSlaveShadow[i - SCMD_EXT_INV] )
+        {
+            extSlaveShadow[i - SCMD_EXT_INV] = extSlaveTable[i];
+            returnVar = true;
+        }
+    }
+    return returnVar;
+}
+
+//Slaves come back from a re-enumeration with default settings, push anything that isn't
+void resetExtSlaveShadow( void )
+{
+    uint8_t i;
+    for( i = SCMD_EXT_INV; i < SCMD_EXT_LENGTH; i++ )
+    {
+        extSlaveShadow[i - SCMD_EXT_INV] = 0;
+    }
+}
+
+//Raw inversion and bridging bytes of the extended slave page (SCMD_EXT_INV on)
+uint8_t readExtSlaveSetting( uint8_t offset )
+{
+    if(( offset < SCMD_EXT_INV )||( offset >= SCMD_EXT_LENGTH )) return 0;
+    return extSlaveTable[offset];
+}
+
+void writeExtSlaveSetting( uint8_t offset, uint8_t dataToWrite )
+{
+    if(( offset < SCMD_EXT_INV )||( offset >= SCMD_EXT_LENGTH )) return;
+    extSlaveTable[offset] = dataToWrite;
+}
@@ -19,14 +19,42 @@ Distributed as-is; no warranty is given.
 
 void initDevRegisters( void );
 uint8_t readDevRegister( uint8_t regNumberIn );
+void readDevRegisterBurst( uint8_t regNumberIn, uint8_t * buffer, uint8_t count );
 void writeDevRegister( uint8_t regNumberIn, uint8_t dataToWrite );
+void writeDevRegisterInternal( uint8_t regNumberIn, uint8_t dataToWrite ); //Firmware writes, skips the lock check
 void writeDevRegisterUnprotected( uint8_t regNumberIn, uint8_t dataToWrite );
 void incrementDevRegister( uint8_t );
 bool getChangedStatus( uint8_t regNumberIn );
 void clearChangedStatus( uint8_t regNumberIn );
+bool getStaticStatus( uint8_t regNumberIn ); //Register doesn't change after enumeration
+bool getWritableStatus( uint8_t regNumberIn ); //Host write allowed under the current keys
 void setColdInitValues( void );
 void setWarmInitValues( void );
 void setBusyBitMem( uint8_t );// Send register value
 void clearBusyBitMem( uint8_t );// Send register value
+void clearAllBusyBitMem( void );
+
+//Number of register pages, page 0 is the register table
+#define REGISTER_PAGE_COUNT 14
+
+//Host facing access (user port), applies SCMD_PAGE_SELECT
+void mapRegisterPage( uint8_t page, uint8_t * data, uint8_t length, bool writable );
+uint8_t readUserRegister( uint8_t regNumberIn );
+void writeUserRegister( uint8_t regNumberIn, uint8_t dataToWrite );
+void readUserRegisterBurst( uint8_t regNumberIn, uint8_t * buffer, uint8_t count );
+void writeUserRegisterBurst( uint8_t regNumberIn, uint8_t * buffer, uint8_t count );
+
+//Motor and slave settings by number, covers the extended slave page
+uint8_t readMotorDrive( uint8_t motorNum );
+void writeMotorDrive( uint8_t motorNum, uint8_t dataToWrite );
+uint8_t readMotorInvert( uint8_t motorNum ); //Slave motors only (2 and up)
+void writeMotorInvert( uint8_t motorNum, uint8_t inverted );
+uint8_t readSlaveBridge( uint8_t slaveIndex );
+bool getExtSlaveChanged( void );
+void resetExtSlaveShadow( void );
+uint8_t readExtSlaveSetting( uint8_t offset );
+void writeExtSlaveSetting( uint8_t offset, uint8_t dataToWrite );
+bool getExtSlaveWritableStatus( uint8_t offset ); //Host write allowed under the current keys
+void clearExtSlaveBusy( void ); //Extended inversion/bridging has been sent
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+/******************************************************************************
+diagCounters.c
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#include <stdint.h>
+#include <project.h>
+#include "devRegisters.h"
+#include "SCMD_config.h"
+#include "diagCounters.h"
+
+//Wide diagnostic counters
+//
+//The 8 bit error and event counters in the register table wrap.  Each one also
+//has a 32 bit counter here that stops at 0xFFFFFFFF instead.  The host can't read
+//these directly: a write of SCMD_DIAG_SNAP to SCMD_DIAG_LATCH copies them all to
+//SCMD_PAGE_DIAG at once, so a burst read of the page is a consistent set no
+//matter how much later it happens.
+
+#define DIAG_COUNTERS (SCMD_DIAG_LATCH_TIME / 4)
+#define DIAG_NONE 0xFF
+
+static uint32_t diagCounts[DIAG_COUNTERS];
+static uint8_t diagSnapshot[SCMD_DIAG_LENGTH]; //Little endian, SCMD_DIAG_* layout
+
+extern volatile uint32_t sysTickMillis;
+
+void initDiagCounters( void )
+{
+    mapRegisterPage( SCMD_PAGE_DIAG, diagSnapshot, SCMD_DIAG_LENGTH, false );
+}
+
+//Counter (SCMD_DIAG_* offset / 4) kept for a register
+static uint8_t diagIndex( uint8_t regNumberIn )
+{
+    switch( regNumberIn )
+    {
+        case SCMD_U_I2C_RD_ERR: return SCMD_DIAG_U_I2C_RD_ERR / 4;
+        case SCMD_U_I2C_WR_ERR: return SCMD_DIAG_U_I2C_WR_ERR / 4;
+        case SCMD_U_BUF_DUMPED: return SCMD_DIAG_U_BUF_DUMPED / 4;
+        case SCMD_E_I2C_RD_ERR: return SCMD_DIAG_E_I2C_RD_ERR / 4;
+        case SCMD_E_I2C_WR_ERR: return SCMD_DIAG_E_I2C_WR_ERR / 4;
+        case SCMD_SLV_POLL_CNT: return SCMD_DIAG_SLV_POLL_CNT / 4;
+        case SCMD_MST_E_ERR: return SCMD_DIAG_MST_E_ERR / 4;
+        case SCMD_FSAFE_FAULTS: return SCMD_DIAG_FSAFE_FAULTS / 4;
+        case SCMD_REG_OOR_CNT: return SCMD_DIAG_REG_OOR_CNT / 4;
+        case SCMD_REG_RO_WRITE_CNT: return SCMD_DIAG_REG_RO_WRITE_CNT / 4;
+        case SCMD_FRAME_LATE_CNT: return SCMD_DIAG_FRAME_LATE_CNT / 4;
+        case SCMD_HOTPLUG_CNT: return SCMD_DIAG_HOTPLUG_CNT / 4;
+        case SCMD_REJOIN_CNT: return SCMD_DIAG_REJOIN_CNT / 4;
+        default: return DIAG_NONE;
+    }
+}
+
+void countDiagEvent( uint8_t regNumberIn )
+{
+    uint8_t index = diagIndex( regNumberIn );
+    uint8_t interruptState;
+    if( index == DIAG_NONE ) return;
+    //Counted from both ISRs and the main loop
+    interruptState = CyEnterCriticalSection();
+    if( diagCounts[index] != 0xFFFFFFFF )
+    {
+        diagCounts[index]++;
+    }
+    CyExitCriticalSection( interruptState );
+}
+
+static void storeDiagWord( uint8_t offset, uint32_t value )
+{
+    diagSnapshot[offset] = value & 0xFF;
+    diagSnapshot[offset + 1] = ( value >> 8 ) & 0xFF;
+    diagSnapshot[offset + 2] = ( value >> 16 ) & 0xFF;
+    diagSnapshot[offset + 3] = ( value >> 24 ) & 0xFF;
+}
+
+void latchDiagCounters( uint8_t control )
+{
+    uint8_t i;
+    uint8_t interruptState = CyEnterCriticalSection();
+    if( control & SCMD_DIAG_SNAP )
+    {
+        for( i = 0; i < DIAG_COUNTERS; i++ )
+        {
+            storeDiagWord( i * 4, diagCounts[i] );
+        }
+        storeDiagWord( SCMD_DIAG_LATCH_TIME, sysTickMillis );
+    }
+    if( control & SCMD_DIAG_CLEAR )
+    {
+        for( i = 0; i < DIAG_COUNTERS; i++ )
+        {
+            diagCounts[i] = 0;
+        }
+    }
+    CyExitCriticalSection( interruptState );
+}
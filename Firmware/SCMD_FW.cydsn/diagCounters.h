@@ -0,0 +1,24 @@
+/******************************************************************************
+diagCounters.h
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#if !defined(DIAGCOUNTERS_H)
+#define DIAGCOUNTERS_H
+#include <stdint.h> 
+#include <stdbool.h>
+
+void initDiagCounters( void );
+void countDiagEvent( uint8_t regNumberIn ); //Called for every incrementDevRegister(), ignores non-counters
+void latchDiagCounters( uint8_t control ); //SCMD_DIAG_LATCH write, SCMD_DIAG_SNAP and/or SCMD_DIAG_CLEAR
+
+#endif
@@ -21,6 +21,13 @@ Distributed as-is; no warranty is given.
 #include "slaveEnumeration.h"
 #include "customSerialInterrupts.h"
 #include "registerHandlers.h"
+#include "remoteAccess.h"
+#include "slaveMonitor.h"
+#include "configStore.h"
+#include "diagCounters.h"
+#include "accessStats.h"
+#include "buildRole.h"
+#include "capabilities.h"
 
 //Debug stuff
 //If USE_SW_CONFIG_BITS is defined, program will use CONFIG_BITS instead of the solder jumpers on the board:
@@ -43,6 +50,13 @@ volatile uint16_t masterSendCounter = 65000;
 volatile bool masterSendCounterReset = 0;
 volatile bool breakCounterWait = false;
 
+//SysTick setup, 24 MHz core
+#define SYSTICK_RELOAD 24000 //1 ms
+#define SYSTICK_TICKS_PER_US 24
+
+//Free running ms count, with SysTick->VAL gives a us timebase
+volatile uint32_t sysTickMillis = 0;
+
 //Reboot variable
 extern volatile bool slaveResetRequested;
 
@@ -57,11 +71,11 @@ int main()
 		DEBUG_TIMER_WriteCounter(0);
 		DEBUG_TIMER_Start();
 		
-        if((CONFIG_BITS == 0) || (CONFIG_BITS == 0x0D) || (CONFIG_BITS == 0x0E)) //UART
+        if(ROLE_IS_UART(CONFIG_BITS)) //UART
         {
             parseUART();
         }
-        else if((CONFIG_BITS >= 0x3)&&(CONFIG_BITS <= 0xC)) //I2C
+        else if(ROLE_IS_I2C(CONFIG_BITS)) //I2C
         {
             //parceI2C is also called before interrupts occur on the bus, but check here too to catch residual buffers
             parseI2C();
@@ -69,7 +83,7 @@ int main()
         //parseSPI() now called from within the interrupt only
 
         
-        if(CONFIG_BITS == 2) //Slave
+        if(ROLE_IS_SLAVE(CONFIG_BITS)) //Slave
         {
             parseSlaveI2C();
             tickSlaveSM();
@@ -101,6 +115,8 @@ CY_ISR(FSAFE_TIMER_Interrupt)
     /* Clear TC Inerrupt */
    	FSAFE_TIMER_ClearInterrupt(FSAFE_TIMER_INTR_MASK_CC_MATCH);
     incrementDevRegister( SCMD_FSAFE_FAULTS );
+    setFaultFlag( SCMD_FAULT_FSAFE );
+    raiseEvent( SCMD_EVT_FSAFE );
     
     //  Plan to escape counter wait
     breakCounterWait = true;
@@ -209,6 +225,7 @@ CY_ISR_PROTO(SYSTICK_ISR);
 CY_ISR(SYSTICK_ISR)
 {
 	/* User ISR Code*/
+    sysTickMillis++;
     if(masterSendCounterReset)
     {
         //clear reset
@@ -224,13 +241,56 @@ CY_ISR(SYSTICK_ISR)
     }
 }
 
+//Time since boot in us (wraps after ~71 minutes)
+uint32_t getSystemMicros( void )
+{
+    uint32_t millis;
+    uint32_t ticks;
+    uint8 interruptState = CyEnterCriticalSection();
+    millis = sysTickMillis;
+    ticks = SysTick->VAL;
+    if( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk )
+    {
+        //Counter reloaded but the ISR hasn't run yet
+        millis++;
+        ticks = SysTick->VAL;
+    }
+    CyExitCriticalSection(interruptState);
+    return ( millis * 1000 ) + (( SYSTICK_RELOAD - 1 - ticks ) / SYSTICK_TICKS_PER_US );
+}
+
 //get the system off the ground - run once at start
 static void systemInit( void )
 {
     initDevRegisters();  //Prep device registers, set initial values (triggers actions)
+    updateHostAlert();  //Release the alert pin (if fitted)
+    initRemoteQueue();  //Map the queue results page
+    initSlaveMonitor();  //Map the telemetry page
+    initExpansionFrame();  //Map the timing page
+    initDriveSchedule();  //Map the update divisor page
+    initDiagCounters();  //Map the wide diagnostics page
+    initConfigBlob();  //Map the config blob page
+    initCapabilities();  //Map the capability page
+#ifdef REGISTER_ACCESS_STATS
+    initAccessStats();  //Map the access statistics page
+#endif
 #ifndef USE_SW_CONFIG_BITS
     CONFIG_BITS = readDevRegister(SCMD_CONFIG_BITS); //Get the bits value
 #endif
+    if(!ROLE_MATCHES(CONFIG_BITS))
+    {
+        //Jumpers select a role this image wasn't built for.  Running as something else
+        //could put a second master on the chain, so stay off the ports with the drivers
+        //disabled and CONFIG_OUT low, and blink the diag LED.
+        A_EN_Write(0);
+        B_EN_Write(0);
+        CONFIG_OUT_Write(0);
+        DIAG_LED_CLK_Stop();
+        DIAG_LED_CLK_Start();
+        setDiagMessage(6, 5);
+        while(1);
+    }
+    if(!ROLE_IS_SLAVE(CONFIG_BITS)) restoreConfig(); //Saved settings over the defaults, slaves get theirs from the master
     
     DIAG_LED_CLK_Stop();
     DIAG_LED_CLK_Start();
@@ -241,7 +301,7 @@ static void systemInit( void )
     CONFIG_IN_Write(0); //Tell the slaves to start fresh
     //Do a boot-up delay
     CyDelay(100u);
-    if(CONFIG_BITS != 0x02) CyDelay(1000u); //Give the slaves extra time
+    if(!ROLE_IS_SLAVE(CONFIG_BITS)) CyDelay(1000u); //Give the slaves extra time
     
     MODE_Write(1);
     
@@ -256,7 +316,7 @@ static void systemInit( void )
 	CyIntSetSysVector((SysTick_IRQn + 16), SYSTICK_ISR);
 	
     /* Enable Systick timer with desired period/number of ticks */
-	SysTick_Config(24000);  //Interrupt should occur every 1 ms
+	SysTick_Config(SYSTICK_RELOAD);  //Interrupt should occur every 1 ms
     
     //Failsafe timer
     FSAFE_ISR_StartEx(FSAFE_TIMER_Interrupt);
@@ -286,7 +346,7 @@ static void systemInit( void )
     Clock_1_Start();
     
     //Config in behavior
-    if(CONFIG_BITS != 0x02) M_IN_ISR_StartEx(ConfigInBehaviorHandler);
+    if(!ROLE_IS_SLAVE(CONFIG_BITS)) M_IN_ISR_StartEx(ConfigInBehaviorHandler);
     
     CyGlobalIntEnable; 
     
@@ -19,44 +19,59 @@ Distributed as-is; no warranty is given.
 #include "SCMD_config.h"
 #include "serial.h"
 #include "slaveEnumeration.h"
+#include "remoteAccess.h"
+#include "configStore.h"
+#include "buildRole.h"
 
 extern const uint16_t SCBCLK_UART_DIVIDER_TABLE[8];
 extern const uint16_t SCBCLK_I2C_DIVIDER_TABLE[4];
 
-//Variables to store user key setup
-static uint8_t savedUserKey = 0;
-static uint8_t savedMasterKey = 0;
-
 extern volatile uint32_t busyBitMemory;
 
 void processMasterRegChanges( void )
 {
+	//Remote traffic waits (flags stay set) when a drive frame is too close for it.
+	//Each op asks for its own slot, sized by its length.
+	
 	//Remote reads (window reads through interface)
-	if(getChangedStatus(SCMD_REM_WRITE))
+	if(getChangedStatus(SCMD_REM_WRITE) && requestExpansionSlot( TRAFFIC_REMOTE, XFER_BYTES_WRITE(1) ))
 	{
-        saveKeysFullAccess(); //allow writes to registers
-        
-		WriteSlaveData( readDevRegister(SCMD_REM_ADDR), readDevRegister(SCMD_REM_OFFSET), readDevRegister(SCMD_REM_DATA_WR) );
-		writeDevRegister( SCMD_REM_WRITE, 0 );
+		writeRemote( readDevRegister(SCMD_REM_ADDR), readDevRegister(SCMD_REM_OFFSET), readDevRegister(SCMD_REM_DATA_WR) );
+		writeDevRegisterInternal( SCMD_REM_WRITE, 0 );
+		raiseEvent( SCMD_EVT_REMOTE_DONE );
 		clearChangedStatus( SCMD_REM_WRITE );
         //*** TEMP CODE ***//
         clearBusyBitMem( SCMD_REM_WRITE );
-        //*** TEMP CODE ***//         
-        restoreKeys();//Replace previous keys
+        //*** TEMP CODE ***//
 	}
 	//Do writes before reads if both present
-	if(getChangedStatus(SCMD_REM_READ))
+	if(getChangedStatus(SCMD_REM_READ) && requestExpansionSlot( TRAFFIC_REMOTE, XFER_BYTES_READ(1) ))
 	{
-        saveKeysFullAccess(); //allow writes to registers
-        
-		writeDevRegister( SCMD_REM_DATA_RD, ReadSlaveData(readDevRegister(SCMD_REM_ADDR), readDevRegister(SCMD_REM_OFFSET)) );
-		writeDevRegister( SCMD_REM_READ, 0 );
+		uint8_t data;
+		readRemoteCached( readDevRegister(SCMD_REM_ADDR), readDevRegister(SCMD_REM_OFFSET), &data );
+		writeDevRegisterInternal( SCMD_REM_DATA_RD, data );
+		writeDevRegisterInternal( SCMD_REM_READ, 0 );
+		raiseEvent( SCMD_EVT_REMOTE_DONE );
 		clearChangedStatus(SCMD_REM_READ);
         //*** TEMP CODE ***//
         clearBusyBitMem( SCMD_REM_READ );
         //*** TEMP CODE ***//
-        restoreKeys();//Replace previous keys
 	} 
+	//Remote block window
+	if(getChangedStatus(SCMD_REM_BLK_OP) && requestExpansionSlot( TRAFFIC_REMOTE, XFER_BYTES_READ( readDevRegister(SCMD_REM_BLK_LEN) > SCMD_REM_BLK_MAX ? SCMD_REM_BLK_MAX : readDevRegister(SCMD_REM_BLK_LEN) ) ))
+	{
+		runRemoteBlockOp();
+		writeDevRegisterInternal( SCMD_REM_BLK_OP, 0 );
+		raiseEvent( SCMD_EVT_REMOTE_DONE );
+		clearChangedStatus(SCMD_REM_BLK_OP);
+        //*** TEMP CODE ***//
+        clearBusyBitMem( SCMD_REM_BLK_OP );
+        //*** TEMP CODE ***//
+	}
+	//Queued remote operations, a few per pass
+	serviceRemoteQueue();
+	//Imported config blob, goes out in one pass ahead of the per-register handlers
+	serviceConfigBlob();
 	//Tell slaves to change their inversion/bridging if the master was written
 
 	//Count number of motors on slaves (0 == no motors)
@@ -69,7 +84,7 @@ void processMasterRegChanges( void )
 	}
 	else
 	{
-		motorTemp = (motorTemp - 0x50 + 1) * 2; //single slave at 0x50 results in 2, 16 slaves (0x5F) results in 32
+		motorTemp = (motorTemp - 0x50 + 1) * 2; //single slave at 0x50 results in 2, 16 slaves (0x5F) results in 32 (the rest are on the extended page)
 	}
 	
 	if(getChangedStatus( SCMD_INV_2_9 ))
@@ -187,7 +202,7 @@ void processMasterRegChanges( void )
 		if(readDevRegister(SCMD_SLV_TOP_ADDR) >= 0x50)
 		{
 			//Slave exists in range -- send all bits
-			for(i = 0; (i <= 8) && (motorAddrTemp <= readDevRegister( SCMD_SLV_TOP_ADDR )); i++)
+			for(i = 0; (i < 8) && (motorAddrTemp <= readDevRegister( SCMD_SLV_TOP_ADDR )); i++)
 			{
 				WriteSlaveData( motorAddrTemp, SCMD_BRIDGE, (readDevRegister( SCMD_BRIDGE_SLV_L ) >> i) & 0x01 );
 				motorAddrTemp++;
@@ -205,7 +220,7 @@ void processMasterRegChanges( void )
 		if(readDevRegister( SCMD_SLV_TOP_ADDR ) >= 0x58)
 		{
 			//Slave exists in range -- send all bits
-			for(i = 0; (i <= 8) && (motorAddrTemp <= readDevRegister(SCMD_SLV_TOP_ADDR)); i++)
+			for(i = 0; (i < 8) && (motorAddrTemp <= readDevRegister(SCMD_SLV_TOP_ADDR)); i++)
 			{
 				WriteSlaveData(motorAddrTemp, SCMD_BRIDGE, (readDevRegister( SCMD_BRIDGE_SLV_H ) >> i) & 0x01);
 				motorAddrTemp++;
@@ -216,6 +231,18 @@ void processMasterRegChanges( void )
         //*** TEMP CODE ***//
 		clearChangedStatus( SCMD_BRIDGE_SLV_H );
 	}
+	//Slaves 17 and up (paged, polled for changes)
+	if( getExtSlaveChanged() )
+	{
+		int i;
+		for( i = SCMD_EXT_SLAVE_ADDR; i <= readDevRegister( SCMD_SLV_TOP_ADDR ); i++)
+		{
+			WriteSlaveData( i, SCMD_MOTOR_A_INVERT, readMotorInvert( ((i - START_SLAVE_ADDR) * 2) + 2 ) );
+			WriteSlaveData( i, SCMD_MOTOR_B_INVERT, readMotorInvert( ((i - START_SLAVE_ADDR) * 2) + 3 ) );
+			WriteSlaveData( i, SCMD_BRIDGE, readSlaveBridge( i - START_SLAVE_ADDR ) );
+		}
+		clearExtSlaveBusy();
+	}
 	if(getChangedStatus( SCMD_MASTER_LOCK ))
 	{
 		//Do local
@@ -225,7 +252,6 @@ void processMasterRegChanges( void )
 		for( i = 0x50; i <= readDevRegister(SCMD_SLV_TOP_ADDR); i++)
 		{
 			WriteSlaveData(i, SCMD_LOCAL_MASTER_LOCK, readDevRegister( SCMD_MASTER_LOCK ) );
-			CyDelayUs(100);
 		}
         //*** TEMP CODE ***//
         clearBusyBitMem( SCMD_MASTER_LOCK );
@@ -241,7 +267,6 @@ void processMasterRegChanges( void )
 		for( i = 0x50; i <= readDevRegister(SCMD_SLV_TOP_ADDR); i++)
 		{
 			WriteSlaveData(i, SCMD_LOCAL_USER_LOCK, readDevRegister(SCMD_USER_LOCK) );
-			CyDelayUs(100);
 		}
         //*** TEMP CODE ***//
         clearBusyBitMem( SCMD_USER_LOCK );
@@ -250,21 +275,15 @@ void processMasterRegChanges( void )
 	}
 	if(getChangedStatus( SCMD_E_BUS_SPEED ))
 	{
-		saveKeysFullAccess(); //allow writes to registers
-		
 		//Do local
-		writeDevRegister( SCMD_E_PORT_CLKDIV_U, 0 );
-		writeDevRegister( SCMD_E_PORT_CLKDIV_L, SCBCLK_I2C_DIVIDER_TABLE[readDevRegister(SCMD_E_BUS_SPEED) & 0x03] );
-		writeDevRegister( SCMD_E_PORT_CLKDIV_CTRL, 0 ); //Triggers clock change
-		
-		restoreKeys();//Replace previous keys
-		
+		writeDevRegisterInternal( SCMD_E_PORT_CLKDIV_U, 0 );
+		writeDevRegisterInternal( SCMD_E_PORT_CLKDIV_L, SCBCLK_I2C_DIVIDER_TABLE[readDevRegister(SCMD_E_BUS_SPEED) & 0x03] );
+		writeDevRegisterInternal( SCMD_E_PORT_CLKDIV_CTRL, 0 ); //Triggers clock change
+
 		clearChangedStatus( SCMD_E_BUS_SPEED );
 	}
 	if(getChangedStatus( SCMD_CONTROL_1 ))
 	{
-		saveKeysFullAccess(); //allow writes to registers
-
 		if( readDevRegister( SCMD_CONTROL_1 ) & SCMD_FULL_RESET_BIT )
 		{
 			hardReset();
@@ -273,17 +292,58 @@ void processMasterRegChanges( void )
 		if( readDevRegister( SCMD_CONTROL_1 ) & SCMD_RE_ENUMERATE_BIT )
 		{
 			reEnumerate();
-			writeDevRegister( SCMD_CONTROL_1, readDevRegister( SCMD_CONTROL_1 ) & ~SCMD_RE_ENUMERATE_BIT ); //Clear bit
+			writeDevRegisterInternal( SCMD_CONTROL_1, readDevRegister( SCMD_CONTROL_1 ) & ~SCMD_RE_ENUMERATE_BIT ); //Clear bit
+		}
+		if( readDevRegister( SCMD_CONTROL_1 ) & SCMD_TIMING_RESET_BIT )
+		{
+			resetFrameStats();
+			writeDevRegisterInternal( SCMD_CONTROL_1, readDevRegister( SCMD_CONTROL_1 ) & ~SCMD_TIMING_RESET_BIT ); //Clear bit
+		}
+		if( readDevRegister( SCMD_CONTROL_1 ) & SCMD_SAVE_CONFIG_BIT )
+		{
+			saveConfig();
+			writeDevRegisterInternal( SCMD_CONTROL_1, readDevRegister( SCMD_CONTROL_1 ) & ~SCMD_SAVE_CONFIG_BIT ); //Clear bit
+		}
+		if( readDevRegister( SCMD_CONTROL_1 ) & SCMD_CLEAR_CONFIG_BIT )
+		{
+			clearConfig();
+			writeDevRegisterInternal( SCMD_CONTROL_1, readDevRegister( SCMD_CONTROL_1 ) & ~SCMD_CLEAR_CONFIG_BIT ); //Clear bit
 		}
 		clearChangedStatus( SCMD_CONTROL_1 );
-		
-		restoreKeys();//Replace previous keys
-		
 	}
 }
 
+//Send one slave its inversion and bridging (SCMD_MOTOR_A_INVERT to SCMD_BRIDGE) in one write
+void sendSlaveSettings( uint8_t address )
+{
+	uint8_t slaveIndex = address - START_SLAVE_ADDR;
+	uint8_t settings[3];
+	
+	settings[0] = readMotorInvert( (slaveIndex * 2) + 2 );
+	settings[1] = readMotorInvert( (slaveIndex * 2) + 3 );
+	settings[2] = readSlaveBridge( slaveIndex );
+	WriteSlaveBlock( address, SCMD_MOTOR_A_INVERT, settings, 3 );
+}
+
+//Send the master's copy of one slave's settings to that slave only (hot-plugged slaves).
+//Same set that is replayed after a re-enumeration.
+void pushSlaveConfig( uint8_t address )
+{
+	sendSlaveSettings( address );
+	WriteSlaveData( address, SCMD_FSAFE_TIME, readDevRegister( SCMD_FSAFE_TIME ) );
+	WriteSlaveData( address, SCMD_DRIVER_ENABLE, readDevRegister( SCMD_DRIVER_ENABLE ) & 0x01 );
+}
+
 void processSlaveRegChanges( void )
 {
+	//Master cleared our faults, let go of the fault line
+	if(getChangedStatus( SCMD_FAULT_FLAGS ))
+	{
+#if defined(CY_PINS_SLV_FAULT_H)
+		if( readDevRegister( SCMD_FAULT_FLAGS ) == 0 ) SLV_FAULT_Write( 1 );
+#endif
+		clearChangedStatus( SCMD_FAULT_FLAGS );
+	}
 	//Change our address in the I2C device if the register has changed
 	if(getChangedStatus( SCMD_SLAVE_ADDR ))
 	{
@@ -370,14 +430,13 @@ void processRegChanges( void )
 	if(getChangedStatus( SCMD_FSAFE_TIME ))
 	{
 		uint8_t tempValue = readDevRegister( SCMD_FSAFE_TIME );
-		if(( readDevRegister(SCMD_CONFIG_BITS) != 2 )&&(readDevRegister( SCMD_SLV_TOP_ADDR ) >= 0x50)) //if you are master, and there are slaves
+		if(( !ROLE_IS_SLAVE( readDevRegister( SCMD_CONFIG_BITS ) ) )&&(readDevRegister( SCMD_SLV_TOP_ADDR ) >= 0x50)) //if you are master, and there are slaves
 		{
 			//send out to slaves here
 			int i;
 			for( i = 0x50; i <= readDevRegister( SCMD_SLV_TOP_ADDR ); i++)
 			{
 				WriteSlaveData( i, SCMD_FSAFE_TIME, tempValue );
-				CyDelayUs(100);
 			}
 		}
 		if(tempValue)
@@ -404,14 +463,13 @@ void processRegChanges( void )
 	{
 		A_EN_Write( readDevRegister( SCMD_DRIVER_ENABLE ) & 0x01 );
 		B_EN_Write( readDevRegister( SCMD_DRIVER_ENABLE ) & 0x01 );
-		if(( readDevRegister( SCMD_CONFIG_BITS ) != 2 )&&(readDevRegister( SCMD_SLV_TOP_ADDR ) >= 0x50)) //if you are master, and there are slaves
+		if(( !ROLE_IS_SLAVE( readDevRegister( SCMD_CONFIG_BITS ) ) )&&(readDevRegister( SCMD_SLV_TOP_ADDR ) >= 0x50)) //if you are master, and there are slaves
 		{
 			//send out to slaves here
 			int i;
 			for( i = 0x50; i <= readDevRegister( SCMD_SLV_TOP_ADDR ); i++)
 			{
 				WriteSlaveData( i, SCMD_DRIVER_ENABLE, readDevRegister( SCMD_DRIVER_ENABLE ) & 0x01 );
-				CyDelayUs( 100 );
 			}
 		}
 		
@@ -450,7 +508,11 @@ void processRegChanges( void )
 	}
     if(busyBitMemory == 0)
     {
-        clearStatusBit(SCMD_BUSY_BIT);
+        if( readDevRegister( SCMD_STATUS_1 ) & SCMD_BUSY_BIT )
+        {
+            clearStatusBit(SCMD_BUSY_BIT);
+            raiseEvent( SCMD_EVT_BUSY_CLEAR );
+        }
     }
 
 }
@@ -465,20 +527,33 @@ void clearStatusBit( uint8_t bitMask )
 	writeDevRegisterUnprotected( SCMD_STATUS_1, readDevRegister( SCMD_STATUS_1 ) & ~bitMask); //Clear bit
 }
 
-void saveKeysFullAccess( void )
+//Latch a host event, alerts the host if it's in SCMD_EVENT_MASK
+//Raised from the main loop and the failsafe ISR, cleared from the user port ISR
+void raiseEvent( uint8_t eventMask )
+{
+	uint8_t interruptState = CyEnterCriticalSection();
+	writeDevRegisterUnprotected( SCMD_EVENT_FLAGS, readDevRegister( SCMD_EVENT_FLAGS ) | eventMask );
+	updateHostAlert();
+	CyExitCriticalSection( interruptState );
+}
+
+//Drive the optional HOST_ALERT pin (open drain, active low) from the event registers
+void updateHostAlert( void )
 {
-	//Save current keys
-	savedUserKey = readDevRegister( SCMD_LOCAL_USER_LOCK );
-	savedMasterKey = readDevRegister( SCMD_LOCAL_MASTER_LOCK );
-	//Allow writes
-	writeDevRegister( SCMD_LOCAL_USER_LOCK, USER_LOCK_KEY );
-	writeDevRegister( SCMD_LOCAL_MASTER_LOCK, MASTER_LOCK_KEY );
+#if defined(CY_PINS_HOST_ALERT_H)
+	HOST_ALERT_Write( ( readDevRegister( SCMD_EVENT_FLAGS ) & readDevRegister( SCMD_EVENT_MASK ) ) ? 0 : 1 );
+#endif
 }
 
-void restoreKeys( void )
+//Latch a fault for the master to collect.  Boards built with the optional SLV_FAULT
+//pin (open drain, shared by the chain) also pull it low to alert the master, others
+//wait for the master's poll (see slaveMonitor.c).
+void setFaultFlag( uint8_t faultMask )
 {
-	writeDevRegister( SCMD_LOCAL_MASTER_LOCK, savedMasterKey );
-	writeDevRegister( SCMD_LOCAL_USER_LOCK, savedUserKey );	
+	writeDevRegisterUnprotected( SCMD_FAULT_FLAGS, readDevRegister( SCMD_FAULT_FLAGS ) | faultMask );
+#if defined(CY_PINS_SLV_FAULT_H)
+	if( ROLE_IS_SLAVE( readDevRegister( SCMD_CONFIG_BITS ) ) ) SLV_FAULT_Write( 0 ); //Slaves only, the master listens
+#endif
 }
 
 /* [] END OF FILE */
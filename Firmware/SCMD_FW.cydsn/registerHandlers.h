@@ -20,10 +20,13 @@ Distributed as-is; no warranty is given.
 void processMasterRegChanges( void );
 void processSlaveRegChanges( void );
 void processRegChanges( void );
+void pushSlaveConfig( uint8_t address );
+void sendSlaveSettings( uint8_t address ); //Inversion and bridging only
 void setStatusBit( uint8_t bitMask );
 void clearStatusBit( uint8_t bitMask );
-void saveKeysFullAccess( void );
-void restoreKeys( void );
+void setFaultFlag( uint8_t faultMask );
+void raiseEvent( uint8_t eventMask );
+void updateHostAlert( void );
 
 #endif
 /* [] END OF FILE */
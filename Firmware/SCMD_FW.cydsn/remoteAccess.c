@@ -0,0 +1,263 @@
+/******************************************************************************
+remoteAccess.c
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#include <stdint.h>
+#include <project.h>
+#include "devRegisters.h"
+#include "SCMD_config.h"
+#include "serial.h"
+#include "remoteAccess.h"
+#include "registerHandlers.h"
+#include "slaveEnumeration.h"
+
+//Queued remote register operations
+//
+//The host stages an op in SCMD_REMQ_ADDR, SCMD_REMQ_OFFSET, SCMD_REMQ_DATA
+//then writes SCMD_REMQ_OP.  The op is given the next request ID (shown in
+//SCMD_REMQ_ID) and run in the background by the master.  When it completes,
+//SCMD_REMQ_DONE shows its ID and the result is left in the results page at
+//offset (ID % SCMD_REMQ_DEPTH).  Reads return the slave data, writes return
+//0, or the low byte of the expansion port master status if they failed.  Either
+//kind that failed also sets its bit in SCMD_REMQ_ERRORS.  Ops pushed while the
+//queue is full are dropped and counted in SCMD_REMQ_OVFL_CNT.
+//
+//A burst write to SCMD_REMQ_ADDR wraps after SCMD_REMQ_OP, so many ops can be
+//queued with a single I2C transaction.
+
+//Max ops to run per pass of the main loop
+#define REMQ_OPS_PER_PASS 4
+
+typedef struct
+{
+    uint8_t address;
+    uint8_t offset;
+    uint8_t data;
+    uint8_t op;
+    uint8_t id;
+} remoteOperation_t;
+
+static remoteOperation_t remoteQueue[SCMD_REMQ_DEPTH];
+static volatile uint8_t remoteQueueHead = 0; //Next free entry
+static volatile uint8_t remoteQueueTail = 0; //Next entry to run
+static volatile uint8_t remoteQueueCount = 0;
+static uint8_t remoteResults[SCMD_REMQ_PAGE_LENGTH];
+
+//Remote block window
+//
+//SCMD_REM_BLK_OP copies SCMD_REM_BLK_LEN registers between the slave at
+//SCMD_REM_ADDR (starting at SCMD_REM_OFFSET) and the block window page, in a
+//single expansion transfer.  Window offset 0 is the start offset on the slave.
+static uint8_t remoteBlockWindow[SCMD_REM_BLK_MAX];
+
+//Static register cache
+//
+//Registers flagged static (getStaticStatus) don't change once a slave has an
+//address, so remote reads of them are answered from here after the first.
+//Cleared on re-enumeration, and per slave when hot-plug gives out an address.
+#define REMOTE_CACHE_SLAVES (MAX_SLAVE_ADDR - START_SLAVE_ADDR + 1)
+#define REMOTE_CACHE_REGS 4
+
+static uint8_t cachedRegisters[REMOTE_CACHE_REGS]; //Offsets of the static registers
+static uint8_t cachedRegisterCount = 0;
+static uint8_t remoteCache[REMOTE_CACHE_SLAVES][REMOTE_CACHE_REGS];
+static uint8_t remoteCacheValid[REMOTE_CACHE_SLAVES]; //One bit per cache slot
+
+void initRemoteQueue( void )
+{
+    remoteQueueHead = 0;
+    remoteQueueTail = 0;
+    remoteQueueCount = 0;
+    mapRegisterPage( SCMD_PAGE_REMQ_RESULTS, remoteResults, SCMD_REMQ_PAGE_LENGTH, false );
+    mapRegisterPage( SCMD_PAGE_REM_BLOCK, remoteBlockWindow, SCMD_REM_BLK_MAX, true );
+    
+    //Collect the static registers from the register metadata
+    uint8_t i;
+    cachedRegisterCount = 0;
+    for( i = 0; ( i < SCMD_PAGE_LENGTH )&&( cachedRegisterCount < REMOTE_CACHE_REGS ); i++ )
+    {
+        if( getStaticStatus( i ) )
+        {
+            cachedRegisters[cachedRegisterCount] = i;
+            cachedRegisterCount++;
+        }
+    }
+    clearRemoteCache();
+}
+
+void clearRemoteCache( void )
+{
+    uint8_t i;
+    for( i = 0; i < REMOTE_CACHE_SLAVES; i++ )
+    {
+        remoteCacheValid[i] = 0;
+    }
+}
+
+void clearRemoteCacheSlave( uint8_t address )
+{
+    if(( address >= START_SLAVE_ADDR )&&( address <= MAX_SLAVE_ADDR ))
+    {
+        remoteCacheValid[address - START_SLAVE_ADDR] = 0;
+    }
+}
+
+//Returns the cache slot for a register, or REMOTE_CACHE_REGS if not cached
+static uint8_t getCacheSlot( uint8_t address, uint8_t offset )
+{
+    uint8_t i;
+    if(( address < START_SLAVE_ADDR )||( address > MAX_SLAVE_ADDR ))
+    {
+        return REMOTE_CACHE_REGS;
+    }
+    for( i = 0; i < cachedRegisterCount; i++ )
+    {
+        if( cachedRegisters[i] == offset )
+        {
+            return i;
+        }
+    }
+    return REMOTE_CACHE_REGS;
+}
+
+bool readRemoteCached( uint8_t address, uint8_t offset, uint8_t * data )
+{
+    uint8_t slot = getCacheSlot( address, offset );
+    *data = 0;
+    if( slot >= REMOTE_CACHE_REGS )
+    {
+        return ReadSlaveBlock( address, offset, data, 1 ) == 1;
+    }
+    uint8_t slave = address - START_SLAVE_ADDR;
+    if( remoteCacheValid[slave] & (1 << slot) )
+    {
+        *data = remoteCache[slave][slot];
+        return true;
+    }
+    //Only keep it if the read made it back
+    if( ReadSlaveBlock( address, offset, data, 1 ) == 1 )
+    {
+        remoteCache[slave][slot] = *data;
+        remoteCacheValid[slave] |= (1 << slot);
+        return true;
+    }
+    return false;
+}
+
+uint32_t writeRemote( uint8_t address, uint8_t offset, uint8_t data )
+{
+    uint8_t slot = getCacheSlot( address, offset );
+    if( slot < REMOTE_CACHE_REGS )
+    {
+        //Someone is changing a 'static' register (unlocked slave), read it fresh next time
+        remoteCacheValid[address - START_SLAVE_ADDR] &= ~(1 << slot);
+    }
+    return WriteSlaveData( address, offset, data );
+}
+
+//Called when SCMD_REMQ_OP is written from the user port, may be in interrupt context
+void pushRemoteOperation( void )
+{
+    uint8_t op = readDevRegister( SCMD_REMQ_OP );
+    if(( op != SCMD_REMQ_OP_READ )&&( op != SCMD_REMQ_OP_WRITE ))
+    {
+        return;
+    }
+    if( remoteQueueCount >= SCMD_REMQ_DEPTH )
+    {
+        //Full, drop it and keep a count.  SCMD_REMQ_ID doesn't advance.
+        remoteResults[SCMD_REMQ_OVFL_CNT]++;
+        return;
+    }
+    uint8_t id = readDevRegister( SCMD_REMQ_ID ) + 1;
+    remoteQueue[remoteQueueHead].address = readDevRegister( SCMD_REMQ_ADDR );
+    remoteQueue[remoteQueueHead].offset = readDevRegister( SCMD_REMQ_OFFSET );
+    remoteQueue[remoteQueueHead].data = readDevRegister( SCMD_REMQ_DATA );
+    remoteQueue[remoteQueueHead].op = op;
+    remoteQueue[remoteQueueHead].id = id;
+    remoteQueueHead = (remoteQueueHead + 1) % SCMD_REMQ_DEPTH;
+    remoteQueueCount++;
+    writeDevRegisterUnprotected( SCMD_REMQ_ID, id );
+    writeDevRegisterUnprotected( SCMD_REMQ_PENDING, remoteQueueCount );
+}
+
+void serviceRemoteQueue( void )
+{
+    uint8_t i;
+    for( i = 0; i < REMQ_OPS_PER_PASS; i++ )
+    {
+        if(( remoteQueueCount == 0 )||( requestExpansionSlot( TRAFFIC_REMOTE, XFER_BYTES_READ(1) ) == false ))
+        {
+            return;
+        }
+        remoteOperation_t entry = remoteQueue[remoteQueueTail];
+        uint8_t result;
+        bool failed;
+        if( entry.op == SCMD_REMQ_OP_WRITE )
+        {
+            uint32_t masterStatus = writeRemote( entry.address, entry.offset, entry.data );
+            failed = ( masterStatus & EXPANSION_PORT_I2C_MSTAT_ERR_XFER ) != 0;
+            result = failed ? ( masterStatus & 0xFF ) : 0;
+        }
+        else
+        {
+            failed = !readRemoteCached( entry.address, entry.offset, &result );
+        }
+        uint8_t slot = entry.id % SCMD_REMQ_DEPTH;
+        remoteResults[slot] = result;
+        if( failed )
+        {
+            remoteResults[SCMD_REMQ_ERRORS + ( slot >> 3 )] |= 1 << ( slot & 0x07 );
+        }
+        else
+        {
+            remoteResults[SCMD_REMQ_ERRORS + ( slot >> 3 )] &= ~( 1 << ( slot & 0x07 ));
+        }
+        
+        //Pushes come from the user port interrupt
+        uint8 interruptState = CyEnterCriticalSection();
+        remoteQueueTail = (remoteQueueTail + 1) % SCMD_REMQ_DEPTH;
+        remoteQueueCount--;
+        writeDevRegisterUnprotected( SCMD_REMQ_PENDING, remoteQueueCount );
+        CyExitCriticalSection(interruptState);
+        writeDevRegisterUnprotected( SCMD_REMQ_DONE, entry.id );
+        raiseEvent( SCMD_EVT_REMOTE_DONE );
+    }
+}
+
+void runRemoteBlockOp( void )
+{
+    uint8_t length = readDevRegister( SCMD_REM_BLK_LEN );
+    if( length > SCMD_REM_BLK_MAX )
+    {
+        length = SCMD_REM_BLK_MAX;
+    }
+    if( length == 0 )
+    {
+        return;
+    }
+    switch( readDevRegister( SCMD_REM_BLK_OP ) )
+    {
+        case SCMD_REM_BLK_READ:
+            if( ReadSlaveBlock( readDevRegister( SCMD_REM_ADDR ), readDevRegister( SCMD_REM_OFFSET ), remoteBlockWindow, length ) < length )
+            {
+                incrementDevRegister( SCMD_MST_E_ERR );
+            }
+        break;
+        case SCMD_REM_BLK_WRITE:
+            WriteSlaveBlock( readDevRegister( SCMD_REM_ADDR ), readDevRegister( SCMD_REM_OFFSET ), remoteBlockWindow, length );
+        break;
+        default:
+        break;
+    }
+}
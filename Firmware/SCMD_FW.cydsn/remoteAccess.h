@@ -0,0 +1,29 @@
+/******************************************************************************
+remoteAccess.h
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#if !defined(REMOTEACCESS_H)
+#define REMOTEACCESS_H
+#include <stdint.h> 
+#include <stdbool.h>
+
+void initRemoteQueue( void );
+void pushRemoteOperation( void ); //Queue the op currently in the SCMD_REMQ_* registers
+void serviceRemoteQueue( void ); //Run a few queued ops, call from main loop (master only)
+void runRemoteBlockOp( void ); //Run the block op in SCMD_REM_BLK_OP
+bool readRemoteCached( uint8_t address, uint8_t offset, uint8_t * data ); //Remote read, static registers come from cache.  False if the slave didn't answer
+uint32_t writeRemote( uint8_t address, uint8_t offset, uint8_t data ); //Remote write, keeps cache coherent.  Returns the master status
+void clearRemoteCache( void );
+void clearRemoteCacheSlave( uint8_t address ); //A different board may be answering at this address
+
+#endif
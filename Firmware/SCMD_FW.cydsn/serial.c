@@ -17,8 +17,11 @@ Distributed as-is; no warranty is given.
 #include "SCMD_config.h"
 #include "serial.h"
 #include "registerHandlers.h"
+#include "slaveEnumeration.h"
+#include "buildRole.h"
 
 extern volatile uint8_t CONFIG_BITS;
+extern uint32_t getSystemMicros( void );
 
 /***** The clock divider value written into the register has to be one less from calculated *****/
 
@@ -46,6 +49,39 @@ const uint16_t SCBCLK_I2C_DIVIDER_TABLE[4] = {
 
 //Timeout for writes and reads to the slaves
 #define TIMEOUTCOUNTLIMIT 50000 //roughly 100ms
+//Number of times a packet is sent to a slave that NAKs its address
+#define EXPANSION_NAK_RETRY_LIMIT 4
+
+//Interrupt chained drive frame, see serviceExpansionFrame()
+#define EXPANSION_FRAME_LENGTH (MAX_SLAVE_ADDR - START_SLAVE_ADDR + 1)
+#define TIMING_PAGE_LENGTH 0x1C
+
+typedef struct
+{
+    uint8_t address;
+    uint8_t data[3]; //offset, A drive, B drive
+} frameEntry_t;
+
+static frameEntry_t frameDescriptor[EXPANSION_FRAME_LENGTH];
+static volatile uint8_t frameLength = 0;
+static volatile uint8_t frameIndex = 0;
+static volatile uint8_t frameRetries = 0;
+static volatile bool frameActive = false;
+static volatile uint32_t frameFaults = 0; //One bit per slave that failed its frame write
+static uint32_t frameStartTime = 0;
+
+//Broadcast frame, one general call write with every slave's drives
+static uint8_t broadcastData[EXPANSION_PORT_RX_BUFFER_SIZE];
+static uint8_t broadcastLength = 0; //0 while frames are addressed
+
+//Frame period statistics, relative to getFramePeriodTarget()
+static bool periodValid = false;
+static uint32_t periodTarget = 0;
+static uint32_t periodMin;
+static uint32_t periodMax;
+static uint32_t jitterSum; //Running average x 16
+static uint32_t jitterMax;
+static uint8_t timingPage[TIMING_PAGE_LENGTH];
 
 const USER_PORT_I2C_INIT_STRUCT configI2C =
 {
@@ -77,9 +113,9 @@ const USER_PORT_UART_INIT_STRUCT configUart =
     0u, /* dropOnParityErr: disable */
     0u, /* dropOnFrameErr: disable */
     0u, /* enableWake: disable */
-    USER_PORT_BUFFER_SIZE, /* rxBufferSize: software buffer 10 bytes */
+    USER_PORT_BUFFER_SIZE, /* rxBufferSize: software buffer USER_PORT_BUFFER_SIZE bytes */
     bufferRx, /* rxBuffer: RX software buffer enable */
-    USER_PORT_BUFFER_SIZE, /* txBufferSize: software buffer 10 bytes */
+    USER_PORT_BUFFER_SIZE, /* txBufferSize: software buffer USER_PORT_BUFFER_SIZE bytes */
     bufferTx, /* txBuffer: TX software buffer enable */
     0u, /* enableMultiproc: disable */
     0u, /* multiprocAcceptAddr: disable */
@@ -110,9 +146,9 @@ const USER_PORT_SPI_INIT_STRUCT configSPI =
     8u, //USER_PORT_SPI_TX_DATA_BITS_NUM,
     USER_PORT_BITS_ORDER_MSB_FIRST, //USER_PORT_SPI_BITS_ORDER,
     USER_PORT_SPI_TRANSFER_CONTINUOUS, //USER_PORT_SPI_TRANSFER_SEPARATION, -- Ignored for Slave Mode
-    USER_PORT_BUFFER_SIZE, /* rxBufferSize: software buffer 10 bytes */
+    USER_PORT_BUFFER_SIZE, /* rxBufferSize: software buffer USER_PORT_BUFFER_SIZE bytes */
     bufferRx, /* rxBuffer: RX software buffer enable */
-    USER_PORT_BUFFER_SIZE, /* txBufferSize: software buffer 10 bytes */
+    USER_PORT_BUFFER_SIZE, /* txBufferSize: software buffer USER_PORT_BUFFER_SIZE bytes */
     bufferTx, /* txBuffer: TX software buffer enable */
     1u, //(uint32) USER_PORT_SCB_IRQ_INTERNAL,
     USER_PORT_INTR_RX_NOT_EMPTY, //USER_PORT_SPI_INTR_RX_MASK,
@@ -248,10 +284,13 @@ cystatus SetExpansionScbConfigurationSlave(void)
     EXPANSION_SCBCLK_SetFractionalDividerRegister( (readDevRegister( SCMD_E_PORT_CLKDIV_U ) << 8) | readDevRegister( SCMD_E_PORT_CLKDIV_L ), SCMD_E_PORT_CLKDIV_CTRL );
     EXPANSION_SCBCLK_Start();
     /* Configure to I2C slave operation */
-    EXPANSION_PORT_I2CSlaveInitReadBuf ( expansionBufferTx, USER_PORT_BUFFER_SIZE );
-    EXPANSION_PORT_I2CSlaveInitWriteBuf( expansionBufferRx, USER_PORT_BUFFER_SIZE );
+    EXPANSION_PORT_I2CSlaveInitReadBuf ( expansionBufferTx, EXPANSION_PORT_BUFFER_SIZE );
+    EXPANSION_PORT_I2CSlaveInitWriteBuf( expansionBufferRx, EXPANSION_PORT_RX_BUFFER_SIZE );
     EXPANSION_PORT_I2CInit( &expansionConfigI2CSlave );
     EXPANSION_PORT_I2CSlaveSetAddress( readDevRegister( SCMD_SLAVE_ADDR ) );
+    //Also take general call writes (broadcast drive frames)
+    EXPANSION_PORT_I2C_CTRL_REG &= ~EXPANSION_PORT_I2C_CTRL_S_GENERAL_IGNORE;
+    EXPANSION_PORT_SetSlaveInterruptMode( EXPANSION_PORT_GetSlaveInterruptMode() | EXPANSION_PORT_INTR_SLAVE_I2C_GENERAL );
     //writeDevRegister(SCMD_SLAVE_ADDR, 0x10);
     EXPANSION_PORT_I2CSlaveClearReadBuf();
     EXPANSION_PORT_I2CSlaveClearWriteBuf();
@@ -279,8 +318,9 @@ cystatus SetExpansionScbConfigurationMaster(void)
     EXPANSION_SCBCLK_SetFractionalDividerRegister( (readDevRegister( SCMD_E_PORT_CLKDIV_U ) << 8) | readDevRegister( SCMD_E_PORT_CLKDIV_L ), SCMD_E_PORT_CLKDIV_CTRL );
     EXPANSION_SCBCLK_Start();
     /* Configure to I2C slave operation */
-    EXPANSION_PORT_I2CSlaveInitReadBuf ( expansionBufferTx, USER_PORT_BUFFER_SIZE );
-    EXPANSION_PORT_I2CSlaveInitWriteBuf( expansionBufferRx, USER_PORT_BUFFER_SIZE );
+    EXPANSION_PORT_I2CSlaveInitReadBuf ( expansionBufferTx, EXPANSION_PORT_BUFFER_SIZE );
+    EXPANSION_PORT_I2CSlaveInitWriteBuf( expansionBufferRx, EXPANSION_PORT_RX_BUFFER_SIZE );
+    frameActive = false; //Drop any frame in progress
     EXPANSION_PORT_I2CInit( &expansionConfigI2CMaster );
     EXPANSION_PORT_I2CMasterClearReadBuf();
     EXPANSION_PORT_I2CMasterClearWriteBuf();
@@ -289,52 +329,332 @@ cystatus SetExpansionScbConfigurationMaster(void)
     return (status);
 }
 
-uint8 ReadSlaveData( uint8_t address, uint8_t offset )
+//Wait for the expansion SCB to report the bus free (stop detected) after a transfer.
+//This replaces the fixed turnaround delays that were used between slave packets.
+static void waitExpansionBusFree( void )
 {
-    uint8  buffer[10];
-    uint8_t offsetPointer[1];
-    offsetPointer[0] = offset;
-    uint8_t returnVar = 0;
-    
-    //Write an offset
-    EXPANSION_PORT_I2CMasterWriteBuf( address, offsetPointer, 1, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER );
-
-    /* Waits until master completes write transfer */
     uint16_t timeoutCount = 0;
-    while ((0u == (EXPANSION_PORT_I2CMasterStatus() & EXPANSION_PORT_I2C_MSTAT_WR_CMPLT)) && ( timeoutCount < TIMEOUTCOUNTLIMIT ))
+    while ((0u != (EXPANSION_PORT_I2C_STATUS_REG & EXPANSION_PORT_I2C_STATUS_BUS_BUSY)) && ( timeoutCount < TIMEOUTCOUNTLIMIT ))
     {
         timeoutCount++;
     }
     if( timeoutCount >= TIMEOUTCOUNTLIMIT )
     {
-        //EXPANSION_PORT_slStatus = 0u;
         incrementDevRegister( SCMD_MST_E_ERR );
-        //EXPANSION_PORT_I2C_MASTER_CLEAR_START;
-        //EXPANSION_PORT_I2CMasterSendStop();
-        //SetExpansionScbConfigurationMaster();
-        //initExpansionSerial(CONFIG_BITS); 
     }
+}
 
-    //Get a byte
-    EXPANSION_PORT_I2CMasterReadBuf(address, buffer, 1, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER);
+//Set with the transfer error bit by waitMasterComplete() when it gives up
+#define MASTER_STATUS_TIMEOUT 0x80000000u
 
-    /* Waits until master complete read transfer */
-    while ((0u == (EXPANSION_PORT_I2CMasterStatus() & EXPANSION_PORT_I2C_MSTAT_RD_CMPLT)) && ( timeoutCount < TIMEOUTCOUNTLIMIT ))
+//Wait for a master transfer to finish.  Returns the master status, with the transfer
+//error and MASTER_STATUS_TIMEOUT bits set if the transfer timed out.  The caller
+//counts the error (SCMD_MST_E_ERR), once per transfer.
+static uint32 waitMasterComplete( uint32 completeMask )
+{
+    uint16_t timeoutCount = 0;
+    while ((0u == (EXPANSION_PORT_I2CMasterStatus() & completeMask)) && ( timeoutCount < TIMEOUTCOUNTLIMIT ))
     {
         timeoutCount++;
     }
     if( timeoutCount >= TIMEOUTCOUNTLIMIT )
     {
-        //EXPANSION_PORT_slStatus = 0u;
+        return EXPANSION_PORT_I2CMasterStatus() | EXPANSION_PORT_I2C_MSTAT_ERR_XFER | MASTER_STATUS_TIMEOUT;
+    }
+    return EXPANSION_PORT_I2CMasterStatus();
+}
+
+//****************************************************************************//
+//
+//  Interrupt chained drive frame
+//
+//  The master loads a descriptor (slave address and both drive bytes) for each
+//  slave, then starts the frame.  Each write is launched from the expansion
+//  port ISR exit callback when the previous one completes, so the frame goes
+//  out back to back while the main loop keeps running.  serviceExpansionFrame()
+//  is also polled from the main loop in case the callback is not available.
+//
+//  A broadcast frame is the same machinery with one entry: a single general
+//  call write carrying BROADCAST_TAG and then both drives for every slave, in
+//  slave order.  Each slave picks out its own pair.  Nothing acks per slave,
+//  so broadcast frames can't attribute SCMD_FAULT_NO_ACK to a slave.
+//
+//****************************************************************************//
+static void putTimingWord( uint8_t offset, uint32_t value )
+{
+    timingPage[offset] = value & 0xFF;
+    timingPage[offset + 1] = (value >> 8) & 0xFF;
+    timingPage[offset + 2] = (value >> 16) & 0xFF;
+    timingPage[offset + 3] = (value >> 24) & 0xFF;
+}
+
+static void launchFrameEntry( void )
+{
+    EXPANSION_PORT_I2CMasterClearStatus();
+    if( broadcastLength != 0 )
+    {
+        writeDevRegisterUnprotected( SCMD_MST_E_STATUS, EXPANSION_PORT_I2CMasterWriteBuf( BROADCAST_ADDR, broadcastData, broadcastLength, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER ) );
+        return;
+    }
+    writeDevRegisterUnprotected( SCMD_MST_E_STATUS, EXPANSION_PORT_I2CMasterWriteBuf( frameDescriptor[frameIndex].address, frameDescriptor[frameIndex].data, 3, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER ) );
+}
+
+static void finishFrame( void )
+{
+    uint32_t frameEndTime = getSystemMicros();
+    uint32_t frameTime = frameEndTime - frameStartTime;
+    frameActive = false;
+    putTimingWord( SCMD_TIM_FRAME_END, frameEndTime );
+    if( frameTime > 0xFFFF ) frameTime = 0xFFFF;
+    writeDevRegisterUnprotected( SCMD_FRAME_TIME_L, frameTime & 0xFF );
+    writeDevRegisterUnprotected( SCMD_FRAME_TIME_H, (frameTime >> 8) & 0xFF );
+}
+
+void resetFrameStats( void )
+{
+    periodValid = false;
+    periodMin = 0xFFFFFFFF;
+    periodMax = 0;
+    jitterSum = 0;
+    jitterMax = 0;
+    putTimingWord( SCMD_TIM_PERIOD_LAST, 0 );
+    putTimingWord( SCMD_TIM_PERIOD_MIN, 0 );
+    putTimingWord( SCMD_TIM_PERIOD_MAX, 0 );
+    putTimingWord( SCMD_TIM_JITTER_AVG, 0 );
+    putTimingWord( SCMD_TIM_JITTER_MAX, 0 );
+}
+
+//Called with the start time of each frame
+static void updateFrameStats( uint32_t startTime )
+{
+    uint32_t period = startTime - frameStartTime;
+    uint32_t jitter;
+    
+    if( getFramePeriodTarget() != periodTarget )
+    {
+        //Rate changed, old numbers don't apply
+        periodTarget = getFramePeriodTarget();
+        resetFrameStats();
+    }
+    if( periodValid == false )
+    {
+        periodValid = true;
+        return;
+    }
+    putTimingWord( SCMD_TIM_PERIOD_LAST, period );
+    if( period < periodMin )
+    {
+        periodMin = period;
+        putTimingWord( SCMD_TIM_PERIOD_MIN, period );
+    }
+    if( period > periodMax )
+    {
+        periodMax = period;
+        putTimingWord( SCMD_TIM_PERIOD_MAX, period );
+    }
+    if( periodTarget == 0 )
+    {
+        //Force mode, no set rate to compare against
+        return;
+    }
+    jitter = ( period > periodTarget ) ? ( period - periodTarget ) : ( periodTarget - period );
+    jitterSum = jitterSum - ( jitterSum >> 4 ) + jitter;
+    putTimingWord( SCMD_TIM_JITTER_AVG, jitterSum >> 4 );
+    if( jitter > jitterMax )
+    {
+        jitterMax = jitter;
+        putTimingWord( SCMD_TIM_JITTER_MAX, jitter );
+    }
+}
+
+void initExpansionFrame( void )
+{
+    resetFrameStats();
+    mapRegisterPage( SCMD_PAGE_TIMING, timingPage, TIMING_PAGE_LENGTH, false );
+}
+
+void loadExpansionFrame( uint8_t index, uint8_t address, uint8_t driveA, uint8_t driveB )
+{
+    if( index >= EXPANSION_FRAME_LENGTH ) return;
+    frameDescriptor[index].address = address;
+    frameDescriptor[index].data[0] = SCMD_MA_DRIVE;
+    frameDescriptor[index].data[1] = driveA;
+    frameDescriptor[index].data[2] = driveB;
+}
+
+void loadExpansionBroadcast( uint8_t slaveIndex, uint8_t driveA, uint8_t driveB )
+{
+    if( slaveIndex >= EXPANSION_FRAME_LENGTH ) return;
+    broadcastData[1 + ( slaveIndex << 1 )] = driveA;
+    broadcastData[2 + ( slaveIndex << 1 )] = driveB;
+}
+
+static void beginFrame( uint8_t length );
+
+void startExpansionFrame( uint8_t length )
+{
+    waitExpansionFrameDone();
+    if( length > EXPANSION_FRAME_LENGTH ) length = EXPANSION_FRAME_LENGTH;
+    broadcastLength = 0;
+    beginFrame( length );
+}
+
+//Send the first slaveCount pairs loaded with loadExpansionBroadcast()
+void startExpansionBroadcast( uint8_t slaveCount )
+{
+    waitExpansionFrameDone();
+    if( slaveCount > EXPANSION_FRAME_LENGTH ) slaveCount = EXPANSION_FRAME_LENGTH;
+    broadcastData[0] = BROADCAST_TAG;
+    broadcastLength = 1 + ( slaveCount << 1 );
+    beginFrame( ( slaveCount != 0 ) ? 1 : 0 );
+}
+
+static void beginFrame( uint8_t length )
+{
+    uint32_t startTime = getSystemMicros();
+    updateFrameStats( startTime );
+    frameStartTime = startTime;
+    putTimingWord( SCMD_TIM_FRAME_START, frameStartTime );
+    
+    uint8 interruptState = CyEnterCriticalSection();
+    frameLength = length;
+    frameIndex = 0;
+    frameRetries = 0;
+    if( length == 0 )
+    {
+        finishFrame();
+    }
+    else
+    {
+        frameActive = true;
+        launchFrameEntry();
+    }
+    CyExitCriticalSection(interruptState);
+}
+
+//Advance the frame if the current write has completed.  Safe from ISR or main.
+void serviceExpansionFrame( void )
+{
+    uint8 interruptState = CyEnterCriticalSection();
+    if( frameActive )
+    {
+        uint32 masterStatus = EXPANSION_PORT_I2CMasterStatus();
+        if( masterStatus & EXPANSION_PORT_I2C_MSTAT_WR_CMPLT )
+        {
+            if(( masterStatus & EXPANSION_PORT_I2C_MSTAT_ERR_ADDR_NAK ) && ( frameRetries < EXPANSION_NAK_RETRY_LIMIT ))
+            {
+                //Slave busy, send it again
+                frameRetries++;
+            }
+            else
+            {
+                if( masterStatus & EXPANSION_PORT_I2C_MSTAT_ERR_XFER )
+                {
+                    incrementDevRegister( SCMD_MST_E_ERR );
+                    if( broadcastLength == 0 )
+                    {
+                        frameFaults |= 1ul << ( frameDescriptor[frameIndex].address - START_SLAVE_ADDR );
+                    }
+                }
+                frameRetries = 0;
+                frameIndex++;
+            }
+            if( frameIndex < frameLength )
+            {
+                launchFrameEntry();
+            }
+            else
+            {
+                EXPANSION_PORT_I2CMasterClearStatus();
+                finishFrame();
+            }
+        }
+    }
+    CyExitCriticalSection(interruptState);
+}
+
+//Returns and clears the slaves (bit 0 = START_SLAVE_ADDR) that failed a frame write
+uint32_t takeFrameFaults( void )
+{
+    uint8 interruptState = CyEnterCriticalSection();
+    uint32_t returnVar = frameFaults;
+    frameFaults = 0;
+    CyExitCriticalSection(interruptState);
+    return returnVar;
+}
+
+bool expansionFrameDone( void )
+{
+    return !frameActive;
+}
+
+//Blocking transfers must wait for the bus
+void waitExpansionFrameDone( void )
+{
+    uint32_t timeoutCount = 0;
+    while( frameActive && ( timeoutCount < TIMEOUTCOUNTLIMIT ))
+    {
+        serviceExpansionFrame();
+        timeoutCount++;
+    }
+    if( frameActive )
+    {
+        //Give up on it
         incrementDevRegister( SCMD_MST_E_ERR );
-        //EXPANSION_PORT_I2C_MASTER_CLEAR_START;
-        //EXPANSION_PORT_I2CMasterSendStop();
-        //SetExpansionScbConfigurationMaster();
-        //initExpansionSerial( CONFIG_BITS );
+        frameActive = false;
     }
+}
+
+//Component ISR exit callback (see cyapicallbacks.h)
+void EXPANSION_PORT_I2C_ISR_ExitCallback( void )
+{
+    serviceExpansionFrame();
+}
+
+//Write a packet (offset first) to a slave.  A slave that isn't ready to take another
+//packet NAKs its address, so the packet is retried once the bus is free again.
+//Returns the master status the write completed with.
+static uint32 writeSlaveBuffer( uint8_t address, uint8_t * buffer, uint8_t count )
+{
+    uint8_t retries = 0;
+    uint32 masterStatus;
+    
+    expansionPreempt(); //Due drive frames go first
+    waitExpansionFrameDone();
+    do
+    {
+        writeDevRegisterUnprotected( SCMD_MST_E_STATUS, EXPANSION_PORT_I2CMasterWriteBuf( address, buffer, count, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER ) );
+        masterStatus = waitMasterComplete( EXPANSION_PORT_I2C_MSTAT_WR_CMPLT );
+        EXPANSION_PORT_I2CMasterClearStatus();
+        EXPANSION_PORT_I2CMasterClearReadBuf();
+        EXPANSION_PORT_I2CMasterClearWriteBuf();
+        waitExpansionBusFree();
+        retries++;
+    } while(( masterStatus & EXPANSION_PORT_I2C_MSTAT_ERR_ADDR_NAK ) && ( retries < EXPANSION_NAK_RETRY_LIMIT ));
+    
+    if( masterStatus & EXPANSION_PORT_I2C_MSTAT_ERR_XFER ) incrementDevRegister( SCMD_MST_E_ERR );
+    return masterStatus;
+}
+
+uint8 ReadSlaveData( uint8_t address, uint8_t offset )
+{
+    uint8  buffer[10];
+    uint8_t offsetPointer[1];
+    offsetPointer[0] = offset;
+    uint8_t returnVar = 0;
+    
+    //Write an offset
+    writeSlaveBuffer( address, offsetPointer, 1 );
+
+    //Get a byte
+    EXPANSION_PORT_I2CMasterReadBuf(address, buffer, 1, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER);
+
+    /* Waits until master complete read transfer */
+    uint32 masterStatus = waitMasterComplete( EXPANSION_PORT_I2C_MSTAT_RD_CMPLT );
+    if( masterStatus & MASTER_STATUS_TIMEOUT ) incrementDevRegister( SCMD_MST_E_ERR );
     
     /* Displays transfer status */
-    if (0u == (EXPANSION_PORT_I2C_MSTAT_ERR_XFER & EXPANSION_PORT_I2CMasterStatus()))
+    if (0u == (EXPANSION_PORT_I2C_MSTAT_ERR_XFER & masterStatus))
     {
         /* Check packet structure */
         if ((EXPANSION_PORT_I2CMasterGetReadBufSize() >= 1 ))
@@ -346,74 +666,115 @@ uint8 ReadSlaveData( uint8_t address, uint8_t offset )
     EXPANSION_PORT_I2CMasterClearStatus();
     EXPANSION_PORT_I2CMasterClearReadBuf();
     EXPANSION_PORT_I2CMasterClearWriteBuf();
+    waitExpansionBusFree();
 
     return returnVar;
 }
 
-uint8 WriteSlaveData( uint8_t address, uint8_t offset, uint8_t data )
+uint32 WriteSlaveData( uint8_t address, uint8_t offset, uint8_t data )
 {
-    uint8  buffer[10];
+    uint8  buffer[2];
     buffer[0] = offset;
     buffer[1] = data;
+    
+    return writeSlaveBuffer( address, buffer, 2 );
+}
+
+uint8 WriteSlave2Data( uint8_t address, uint8_t offset, uint8_t data0, uint8_t data1 )
+{
+    uint8  buffer[3];
+    buffer[0] = offset;
+    buffer[1] = data0;
+    buffer[2] = data1;
     uint8_t returnVar = 0;
     
+    writeSlaveBuffer( address, buffer, 3 );
+
+    return returnVar;
+}
+
+//Read a range of slave registers in one transfer.  The slave exposes consecutive
+//registers from the offset, so count can be up to SCMD_REM_BLK_MAX.
+uint8 ReadSlaveBlock( uint8_t address, uint8_t offset, uint8_t * data, uint8_t count )
+{
+    uint8_t offsetPointer[1];
+    offsetPointer[0] = offset;
+    uint8_t returnVar = 0;
+    
+    if( count > SCMD_REM_BLK_MAX ) count = SCMD_REM_BLK_MAX;
+    
     //Write an offset
-    (void) EXPANSION_PORT_I2CMasterWriteBuf(address, buffer, 2, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER);
+    writeSlaveBuffer( address, offsetPointer, 1 );
 
-    /* Waits until master completes write transfer */
-    uint16_t timeoutCount = 0;
-    while ((0u == (EXPANSION_PORT_I2CMasterStatus() & EXPANSION_PORT_I2C_MSTAT_WR_CMPLT)) && ( timeoutCount < TIMEOUTCOUNTLIMIT ))
+    //Get the block
+    EXPANSION_PORT_I2CMasterReadBuf(address, data, count, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER);
+    uint32 masterStatus = waitMasterComplete( EXPANSION_PORT_I2C_MSTAT_RD_CMPLT );
+    if( masterStatus & MASTER_STATUS_TIMEOUT ) incrementDevRegister( SCMD_MST_E_ERR );
+    if (0u == (EXPANSION_PORT_I2C_MSTAT_ERR_XFER & masterStatus))
     {
-        timeoutCount++;
-    }
-    if( timeoutCount >= TIMEOUTCOUNTLIMIT )
-    {
-        //EXPANSION_PORT_slStatus = 0u;
-        incrementDevRegister( SCMD_MST_E_ERR );
-        //EXPANSION_PORT_I2C_MASTER_CLEAR_START;
-        //EXPANSION_PORT_I2CMasterSendStop();
-        //SetExpansionScbConfigurationMaster();
-        //initExpansionSerial(CONFIG_BITS);
+        returnVar = EXPANSION_PORT_I2CMasterGetReadBufSize();
     }
 
-    if( EXPANSION_PORT_I2CMasterClearStatus() & EXPANSION_PORT_I2C_MSTAT_ERR_XFER ) incrementDevRegister( SCMD_MST_E_ERR );
+    EXPANSION_PORT_I2CMasterClearStatus();
     EXPANSION_PORT_I2CMasterClearReadBuf();
     EXPANSION_PORT_I2CMasterClearWriteBuf();
+    waitExpansionBusFree();
 
     return returnVar;
 }
 
-uint8 WriteSlave2Data( uint8_t address, uint8_t offset, uint8_t data0, uint8_t data1 )
+//Write a range of slave registers in one transfer
+void WriteSlaveBlock( uint8_t address, uint8_t offset, uint8_t * data, uint8_t count )
 {
-    uint8  buffer[10];
+    uint8  buffer[EXPANSION_PORT_BUFFER_SIZE];
+    uint8_t i;
+    
+    if( count > SCMD_REM_BLK_MAX ) count = SCMD_REM_BLK_MAX;
     buffer[0] = offset;
-    buffer[1] = data0;
-    buffer[2] = data1;
-    uint8_t returnVar = 0;
+    for( i = 0; i < count; i++ )
+    {
+        buffer[i + 1] = data[i];
+    }
+    
+    writeSlaveBuffer( address, buffer, count + 1 );
+}
+
+//Single attempt read that doesn't count errors.  Used to look for slaves that may not
+//be there (a NAK is the expected answer).  Returns true if the slave answered.
+bool ProbeSlaveData( uint8_t address, uint8_t offset, uint8_t * data )
+{
+    uint8_t offsetPointer[1];
+    offsetPointer[0] = offset;
+    bool returnVar = false;
+    uint32 masterStatus;
+    
+    expansionPreempt(); //Due drive frames go first
+    waitExpansionFrameDone();
     
     //Write an offset
-    writeDevRegister( SCMD_MST_E_STATUS, EXPANSION_PORT_I2CMasterWriteBuf( address, buffer, 3, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER ) );
+    EXPANSION_PORT_I2CMasterWriteBuf( address, offsetPointer, 1, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER );
+    masterStatus = waitMasterComplete( EXPANSION_PORT_I2C_MSTAT_WR_CMPLT );
+    //An empty address NAKs, only a hung bus counts as an error
+    if( masterStatus & MASTER_STATUS_TIMEOUT ) incrementDevRegister( SCMD_MST_E_ERR );
+    EXPANSION_PORT_I2CMasterClearStatus();
+    EXPANSION_PORT_I2CMasterClearWriteBuf();
+    waitExpansionBusFree();
     
-    /* Waits until master completes write transfer */
-    uint16_t timeoutCount = 0;
-    while ((0u == (EXPANSION_PORT_I2CMasterStatus() & EXPANSION_PORT_I2C_MSTAT_WR_CMPLT)) && ( timeoutCount < TIMEOUTCOUNTLIMIT ))
-    {
-        timeoutCount++;
-    }
-    if( timeoutCount >= TIMEOUTCOUNTLIMIT )
+    if( 0u == ( EXPANSION_PORT_I2C_MSTAT_ERR_XFER & masterStatus ))
     {
-        //EXPANSION_PORT_slStatus = 0u;
-        incrementDevRegister( SCMD_MST_E_ERR );
-        //EXPANSION_PORT_I2C_MASTER_CLEAR_START;
-        //EXPANSION_PORT_I2CMasterSendStop();
-        //SetExpansionScbConfigurationMaster();
-        //initExpansionSerial(CONFIG_BITS); 
+        //Get a byte
+        EXPANSION_PORT_I2CMasterReadBuf( address, data, 1, EXPANSION_PORT_I2C_MODE_COMPLETE_XFER );
+        masterStatus = waitMasterComplete( EXPANSION_PORT_I2C_MSTAT_RD_CMPLT );
+        if( masterStatus & MASTER_STATUS_TIMEOUT ) incrementDevRegister( SCMD_MST_E_ERR );
+        if(( 0u == ( EXPANSION_PORT_I2C_MSTAT_ERR_XFER & masterStatus ))&&( EXPANSION_PORT_I2CMasterGetReadBufSize() >= 1 ))
+        {
+            returnVar = true;
+        }
+        EXPANSION_PORT_I2CMasterClearStatus();
+        EXPANSION_PORT_I2CMasterClearReadBuf();
+        waitExpansionBusFree();
     }
-
-    if( EXPANSION_PORT_I2CMasterClearStatus() & EXPANSION_PORT_I2C_MSTAT_ERR_XFER ) incrementDevRegister( SCMD_MST_E_ERR );
-    EXPANSION_PORT_I2CMasterClearReadBuf();
-    EXPANSION_PORT_I2CMasterClearWriteBuf();
-
+    
     return returnVar;
 }
 
@@ -424,61 +785,53 @@ uint8 WriteSlave2Data( uint8_t address, uint8_t offset, uint8_t data0, uint8_t d
 //****************************************************************************//
 void calcUserDivider( uint8_t configBitsVar )
 {
-    saveKeysFullAccess(); //allow writes to registers
-    
     //Config USER_PORT
-    if((configBitsVar == 0) || (configBitsVar == 0x0D) || (configBitsVar == 0x0E)) //UART
+    if(ROLE_IS_UART(configBitsVar)) //UART
     {
-        writeDevRegister(SCMD_U_PORT_CLKDIV_U, (SCBCLK_UART_DIVIDER_TABLE[readDevRegister(SCMD_U_BUS_UART_BAUD) & 0x07] & 0xFF00) >> 8);
-        writeDevRegister(SCMD_U_PORT_CLKDIV_L, SCBCLK_UART_DIVIDER_TABLE[readDevRegister(SCMD_U_BUS_UART_BAUD) & 0x07] & 0x00FF);
-        writeDevRegister(SCMD_U_PORT_CLKDIV_CTRL, 0);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_U, (SCBCLK_UART_DIVIDER_TABLE[readDevRegister(SCMD_U_BUS_UART_BAUD) & 0x07] & 0xFF00) >> 8);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_L, SCBCLK_UART_DIVIDER_TABLE[readDevRegister(SCMD_U_BUS_UART_BAUD) & 0x07] & 0x00FF);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_CTRL, 0);
     }
-    else if(configBitsVar == 1) //SPI
+    else if(ROLE_IS_SPI(configBitsVar)) //SPI
     {
-        writeDevRegister(SCMD_U_PORT_CLKDIV_U, 0);
-        writeDevRegister(SCMD_U_PORT_CLKDIV_L, 1);
-        writeDevRegister(SCMD_U_PORT_CLKDIV_CTRL, 0);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_U, 0);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_L, 1);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_CTRL, 0);
     }
-    else if((configBitsVar >= 0x3)&&(configBitsVar <= 0xC)) //I2C
+    else if(ROLE_IS_I2C(configBitsVar)) //I2C
     {
-        writeDevRegister(SCMD_U_PORT_CLKDIV_U, 0);
-        writeDevRegister(SCMD_U_PORT_CLKDIV_L, 1);
-        writeDevRegister(SCMD_U_PORT_CLKDIV_CTRL, 0);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_U, 0);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_L, 1);
+        writeDevRegisterInternal(SCMD_U_PORT_CLKDIV_CTRL, 0);
     }
     
     //Clear all flags
     clearChangedStatus( SCMD_U_PORT_CLKDIV_U );
     clearChangedStatus( SCMD_U_PORT_CLKDIV_L );
     clearChangedStatus( SCMD_U_PORT_CLKDIV_CTRL );
-    
-    restoreKeys();//Replace previous keys
 }
 
 //This configures 
 void calcExpansionDivider( uint8_t configBitsVar )
 {
-    saveKeysFullAccess(); //allow writes to registers
- 
     //Config EXPANSION_PORT
-    if(configBitsVar == 2) //Slave
+    if(ROLE_IS_SLAVE(configBitsVar)) //Slave
     {
-        writeDevRegister(SCMD_E_PORT_CLKDIV_U, 0);
-        writeDevRegister(SCMD_E_PORT_CLKDIV_L, 1);
-        writeDevRegister(SCMD_E_PORT_CLKDIV_CTRL, 0);
+        writeDevRegisterInternal(SCMD_E_PORT_CLKDIV_U, 0);
+        writeDevRegisterInternal(SCMD_E_PORT_CLKDIV_L, 1);
+        writeDevRegisterInternal(SCMD_E_PORT_CLKDIV_CTRL, 0);
     }
     else
     {
-        writeDevRegister(SCMD_E_PORT_CLKDIV_U, 0);
-        writeDevRegister(SCMD_E_PORT_CLKDIV_L, SCBCLK_I2C_DIVIDER_TABLE[readDevRegister(SCMD_E_BUS_SPEED) & 0x03]);
-        writeDevRegister(SCMD_E_PORT_CLKDIV_CTRL, 0);
+        writeDevRegisterInternal(SCMD_E_PORT_CLKDIV_U, 0);
+        writeDevRegisterInternal(SCMD_E_PORT_CLKDIV_L, SCBCLK_I2C_DIVIDER_TABLE[readDevRegister(SCMD_E_BUS_SPEED) & 0x03]);
+        writeDevRegisterInternal(SCMD_E_PORT_CLKDIV_CTRL, 0);
     }
     //Clear flags
     clearChangedStatus( SCMD_E_PORT_CLKDIV_U );
     clearChangedStatus( SCMD_E_PORT_CLKDIV_L );
     clearChangedStatus( SCMD_E_PORT_CLKDIV_CTRL );
 
-    restoreKeys();//Replace previous keys
-
 }
 
 extern void custom_USER_PORT_SPI_UART_ISR( void );
@@ -491,11 +844,11 @@ extern void parseI2C( void );
 void initUserSerial( uint8_t configBitsVar ) //Pass configuration word
 {
     //Config USER_PORT
-    if((configBitsVar == 0) || (configBitsVar == 0x0D) || (configBitsVar == 0x0E)) //UART
+    if(ROLE_IS_UART(configBitsVar)) //UART
     {
         SetScbConfiguration( OP_MODE_UART );
     }
-    else if(configBitsVar == 1) //SPI
+    else if(ROLE_IS_SPI(configBitsVar)) //SPI
     {
         SetScbConfiguration( OP_MODE_SPI );
         USER_PORT_SpiUartClearRxBuffer();
@@ -506,7 +859,7 @@ void initUserSerial( uint8_t configBitsVar ) //Pass configuration word
         //overwrite custom ISR to vector table
         CyIntSetVector( USER_PORT_ISR_NUMBER, &custom_USER_PORT_SPI_UART_ISR );
     }
-    else if((configBitsVar >= 0x3)&&(configBitsVar <= 0xE)) //I2C
+    else if(ROLE_IS_I2C(configBitsVar)) //I2C
     {
         SetScbConfiguration( OP_MODE_I2C );
         USER_PORT_SetCustomInterruptHandler( parseI2C );
@@ -517,7 +870,7 @@ extern void parseSlaveI2C( void );
 void initExpansionSerial( uint8_t configBitsVar ) //Pass configuration word
 {
     //Config EXPANSION_PORT
-    if(configBitsVar == 2) //Slave
+    if(ROLE_IS_SLAVE(configBitsVar)) //Slave
     {
         SetExpansionScbConfigurationSlave();
         EXPANSION_PORT_SetCustomInterruptHandler( parseSlaveI2C );
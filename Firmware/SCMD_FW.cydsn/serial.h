@@ -16,16 +16,23 @@ Distributed as-is; no warranty is given.
 #define SERIAL_H
 
 #include <project.h>
+#include <stdbool.h>
 
-#define USER_PORT_BUFFER_SIZE (10u)
+//Sized for a register address plus a 32 byte burst (I2C user port)
+#define USER_PORT_BUFFER_SIZE (34u)
 
 /* Common buffers or I2C and UART */
 uint8 bufferRx[USER_PORT_BUFFER_SIZE + 1u];/* RX software buffer requires one extra entry for correct operation in UART mode */
 uint8 bufferTx[USER_PORT_BUFFER_SIZE]; /* TX software buffer */
 
+//Offset plus a block of SCMD_REM_BLK_MAX
+#define EXPANSION_PORT_BUFFER_SIZE (33u)
+//Slaves also take broadcast frames, tag plus two drives for 32 slaves
+#define EXPANSION_PORT_RX_BUFFER_SIZE (65u)
+
 /* Buffers for expansion port */
-uint8 expansionBufferRx[USER_PORT_BUFFER_SIZE + 1u];/* RX software buffer requires one extra entry for correct operation in UART mode */
-uint8 expansionBufferTx[USER_PORT_BUFFER_SIZE]; /* TX software buffer */
+uint8 expansionBufferRx[EXPANSION_PORT_RX_BUFFER_SIZE + 1u];/* RX software buffer requires one extra entry for correct operation in UART mode */
+uint8 expansionBufferTx[EXPANSION_PORT_BUFFER_SIZE]; /* TX software buffer */
 
 
 //#define SCBCLK_I2C_DIVIDER (7u) // I2C Slave: 100 kbps Required SCBCLK = 1.6 MHz, Div = 15  ----- good for 100kHZ
@@ -43,8 +50,23 @@ cystatus SetExpansionScbConfigurationSlave(void);
 cystatus SetExpansionScbConfigurationMaster(void);
 
 uint8 ReadSlaveData( uint8_t address, uint8_t offset );
-uint8 WriteSlaveData( uint8_t address, uint8_t offset, uint8_t data );
+uint32 WriteSlaveData( uint8_t address, uint8_t offset, uint8_t data ); //Returns the master status, ERR_XFER set if it failed
 uint8 WriteSlave2Data( uint8_t address, uint8_t offset, uint8_t data0, uint8_t data1 );
+uint8 ReadSlaveBlock( uint8_t address, uint8_t offset, uint8_t * data, uint8_t count ); //Returns bytes read
+void WriteSlaveBlock( uint8_t address, uint8_t offset, uint8_t * data, uint8_t count );
+bool ProbeSlaveData( uint8_t address, uint8_t offset, uint8_t * data ); //No retries or error counts
+
+//Interrupt chained drive frame
+void initExpansionFrame( void );
+void loadExpansionFrame( uint8_t index, uint8_t address, uint8_t driveA, uint8_t driveB );
+void startExpansionFrame( uint8_t length );
+void loadExpansionBroadcast( uint8_t slaveIndex, uint8_t driveA, uint8_t driveB );
+void startExpansionBroadcast( uint8_t slaveCount );
+void serviceExpansionFrame( void );
+bool expansionFrameDone( void );
+uint32_t takeFrameFaults( void );
+void waitExpansionFrameDone( void );
+void resetFrameStats( void );
 void calcUserDivider( uint8_t configBitsVar ); //Pass configuration word
 void calcExpansionDivider( uint8_t configBitsVar ); //Pass configuration word
 void initUserSerial( uint8_t configBitsVar ); //Pass configuration word
@@ -21,6 +21,9 @@ Distributed as-is; no warranty is given.
 #include "serial.h"
 #include "diagLEDS.h"
 #include "slaveEnumeration.h"
+#include "slaveMonitor.h"
+#include "remoteAccess.h"
+#include "buildRole.h"
 
 //Variables and associated #defines use in functions
 static uint8_t slaveAddrEnumerator;
@@ -31,6 +34,9 @@ volatile bool slaveResetRequested = false;
 #define SCMDSlaveWaitForSync 1
 #define SCMDSlaveWaitForAddr 2
 #define SCMDSlaveDone 3
+#define SCMDSlaveRejoin 4
+
+static uint32_t rejoinStart = 0;
 
 static uint8_t slaveState = SCMDSlaveIdle;
 
@@ -46,13 +52,334 @@ extern volatile uint16_t masterSendCounter;
 extern volatile bool masterSendCounterReset; //set this to 1 to reset counter.... self clearing
 extern volatile bool breakCounterWait;
 
-extern volatile uint32_t busyBitMemory;
+extern volatile uint32_t sysTickMillis;
 
 //Functions
 
-void tickMasterSM( void )
+//****************************************************************************//
+//
+//  Expansion bus scheduling
+//
+//  Drive frames have hard priority.  Any blocking expansion transfer first calls
+//  expansionPreempt(), which sends a due frame before the transfer goes out, so
+//  a long run of config or remote traffic can delay a frame by one transfer at
+//  most.  Lower classes ask requestExpansionSlot() before starting, and only
+//  get the bus when the next frame is further away than the transfer takes at
+//  the current SCMD_E_BUS_SPEED, plus a margin for the class.
+//
+//****************************************************************************//
+//Time (us) left over before the next frame, per class
+#define TRAFFIC_REMOTE_MARGIN_US 500
+#define TRAFFIC_DIAG_MARGIN_US 1500
+
+//Expansion bus clock per SCMD_E_BUS_SPEED setting (SCBCLK_I2C_DIVIDER_TABLE)
+static const uint16_t expansionBusKhz[4] = { 50, 100, 400, 400 };
+
+//With SCMD_UPDATE_PERIOD set, frames run on a us deadline instead of masterSendCounter.
+//A frame due within this time is waited for in a tight loop rather than the main loop.
+#define FRAME_SPIN_US 100
+
+//Per slave update divisors.  Slave n goes out on frames where (frame + n) % divisor
+//is 0, so slow slaves with the same divisor are spread over the frames.  A slave
+//skipped for longer than its SCMD_FSAFE_TIME will trip its failsafe.
+#define SCHEDULE_SLAVES (MAX_SLAVE_ADDR - START_SLAVE_ADDR + 1)
+
+static uint8_t slaveDivisors[SCHEDULE_SLAVES];
+static uint8_t frameCount = 0;
+
+static bool sendingFrame = false;
+static uint32_t nextFrameTime = 0;
+static uint16_t activePeriodUs = 0;
+
+extern uint32_t getSystemMicros( void );
+
+static uint16_t getUpdatePeriodUs( void )
+{
+    return readDevRegister( SCMD_UPDATE_PERIOD_L ) | ( (uint16_t)readDevRegister( SCMD_UPDATE_PERIOD_H ) << 8 );
+}
+
+//Set frame period in us, 0 in force mode
+uint32_t getFramePeriodTarget( void )
+{
+    if( getUpdatePeriodUs() != 0 )
+    {
+        return getUpdatePeriodUs();
+    }
+    return (uint32_t)readDevRegister( SCMD_UPDATE_RATE ) * 1000;
+}
+
+//True when the master is running and the next drive frame should go out
+bool driveFrameDue( void )
+{
+    if( masterState != SCMDMasterWait )
+    {
+        return false;
+    }
+    if( getUpdatePeriodUs() != 0 )
+    {
+        return (int32_t)( getSystemMicros() - nextFrameTime ) >= 0;
+    }
+    if( readDevRegister( SCMD_UPDATE_RATE ) != 0 )
+    {
+        return masterSendCounter >= readDevRegister( SCMD_UPDATE_RATE );
+    }
+    //force mode
+    return readDevRegister( SCMD_FORCE_UPDATE ) != 0;
+}
+
+//Build the frame descriptor and start it, the expansion ISR sends it (and saves timing)
+static void sendDriveFrame( void )
 {
     int slaveAddri;
+    uint8_t frameLength = 0;
+    
+    uint16_t periodUs = getUpdatePeriodUs();
+    
+    sendingFrame = true;
+    //The ISR sends the last frame straight from the descriptor and broadcast buffers,
+    //let it finish before they're loaded again
+    waitExpansionFrameDone();
+    if( periodUs != 0 )
+    {
+        //Schedule from the deadline, not from now, so errors don't add up
+        uint32_t now = getSystemMicros();
+        if( periodUs != activePeriodUs )
+        {
+            activePeriodUs = periodUs;
+            nextFrameTime = now;
+        }
+        else if( (int32_t)( now - nextFrameTime ) >= periodUs )
+        {
+            //Missed a whole period, start over from now
+            incrementDevRegister( SCMD_FRAME_LATE_CNT );
+            nextFrameTime = now;
+        }
+        nextFrameTime += periodUs;
+    }
+    else if( readDevRegister( SCMD_UPDATE_RATE ) != 0 )
+    {
+        //Count frames that missed their period
+        if( masterSendCounter > readDevRegister( SCMD_UPDATE_RATE ) ) incrementDevRegister( SCMD_FRAME_LATE_CNT );
+    }
+    else if( readDevRegister( SCMD_FORCE_UPDATE ) )
+    {
+        //clear force reg
+        writeDevRegister( SCMD_FORCE_UPDATE, 0 ); //This sets a busy bit
+    }
+    //Set output drive levels for master
+    PWM_1_WriteCompare( readDevRegister( SCMD_MA_DRIVE ) );
+    PWM_2_WriteCompare( readDevRegister( SCMD_MB_DRIVE ) ); 
+    if( readDevRegister( SCMD_FRAME_CTRL ) & SCMD_FRAME_BROADCAST )
+    {
+        //Every slave, every frame, in one write.  Divisors don't apply.
+        for (slaveAddri = START_SLAVE_ADDR; slaveAddri <= readDevRegister(SCMD_SLV_TOP_ADDR); slaveAddri++)
+        {
+            loadExpansionBroadcast( slaveAddri - START_SLAVE_ADDR, readMotorDrive( ((slaveAddri - START_SLAVE_ADDR) << 1 ) + 2 ), readMotorDrive( ((slaveAddri - START_SLAVE_ADDR) << 1 ) + 3 ) );
+            frameLength++;
+        }
+        startExpansionBroadcast( frameLength );
+    }
+    else
+    {
+        for (slaveAddri = START_SLAVE_ADDR; slaveAddri <= readDevRegister(SCMD_SLV_TOP_ADDR); slaveAddri++)
+        {
+            uint8_t divisor = slaveDivisors[slaveAddri - START_SLAVE_ADDR];
+            if(( divisor > 1 )&&((( frameCount + slaveAddri - START_SLAVE_ADDR ) % divisor ) != 0 ))
+            {
+                //Not this slave's turn
+                continue;
+            }
+            //Write drive states out to slaves
+            //Slave n (0 based) has motors 2n + 2 and 2n + 3
+            loadExpansionFrame( frameLength, slaveAddri, readMotorDrive( ((slaveAddri - START_SLAVE_ADDR) << 1 ) + 2 ), readMotorDrive( ((slaveAddri - START_SLAVE_ADDR) << 1 ) + 3 ) );
+            frameLength++;
+        }
+        startExpansionFrame( frameLength );
+    }
+    frameCount++;
+    if( periodUs == 0 )
+    {
+        activePeriodUs = 0; //Restart the deadline if us mode comes back
+        masterSendCounterReset = 1; //Request the ISR to reset the counter
+        while((masterSendCounter > 0)&&(breakCounterWait == false)); //Counter now = 0
+        breakCounterWait = false;
+    }
+    //*** TEMP CODE ***//
+    clearBusyBitMem( SCMD_FORCE_UPDATE );
+    //*** TEMP CODE ***//
+    sendingFrame = false;
+}
+
+void initDriveSchedule( void )
+{
+    uint8_t i;
+    for( i = 0; i < SCHEDULE_SLAVES; i++ )
+    {
+        slaveDivisors[i] = 0;
+    }
+    mapRegisterPage( SCMD_PAGE_SLAVE_DIV, slaveDivisors, SCHEDULE_SLAVES, true );
+}
+
+//Called before each blocking expansion transfer
+void expansionPreempt( void )
+{
+    if(( sendingFrame == false )&&( driveFrameDue() ))
+    {
+        sendDriveFrame();
+    }
+}
+
+//Time a transfer of wireBytes (address bytes included, see XFER_BYTES_*) keeps the
+//expansion bus, 9 clocks per byte
+static uint32_t expansionTransferUs( uint8_t wireBytes )
+{
+    return ( (uint32_t)wireBytes * 9 * 1000 ) / expansionBusKhz[readDevRegister( SCMD_E_BUS_SPEED ) & 0x03];
+}
+
+//Returns true if a transfer of this class, wireBytes long, may start now
+bool requestExpansionSlot( uint8_t trafficClass, uint8_t wireBytes )
+{
+    uint32_t margin;
+    uint8_t updateRate = readDevRegister( SCMD_UPDATE_RATE );
+    
+    expansionPreempt();
+    switch( trafficClass )
+    {
+        case TRAFFIC_DRIVE:
+        case TRAFFIC_CONFIG:
+            return true;
+        case TRAFFIC_REMOTE:
+            margin = TRAFFIC_REMOTE_MARGIN_US;
+        break;
+        default:
+            margin = TRAFFIC_DIAG_MARGIN_US;
+        break;
+    }
+    margin += expansionTransferUs( wireBytes );
+    if( masterState != SCMDMasterWait )
+    {
+        //Not sending frames
+        return true;
+    }
+    if( getUpdatePeriodUs() != 0 )
+    {
+        return (int32_t)( nextFrameTime - getSystemMicros() ) > (int32_t)margin;
+    }
+    if( updateRate == 0 )
+    {
+        //Force mode (no schedule to protect)
+        return true;
+    }
+    //Counter is in ms, round the margin up
+    return ( masterSendCounter + ( margin + 999 ) / 1000 ) < updateRate;
+}
+
+//True if a us scheduled frame is due within FRAME_SPIN_US
+static bool driveFrameDueSoon( void )
+{
+    if( getUpdatePeriodUs() == 0 )
+    {
+        return false;
+    }
+    return (int32_t)( nextFrameTime - getSystemMicros() ) < FRAME_SPIN_US;
+}
+
+//****************************************************************************//
+//
+//  Hot-plug
+//
+//  A slave added to a running chain sees CONFIG_IN high (the slave before it
+//  drives CONFIG_OUT once it has an address) and comes up on POLL_ADDRESS.  The
+//  master looks there now and then, gives it an address and sends it just its own
+//  settings, without stopping the rest of the chain.
+//
+//  The address is the first one up to SCMD_SLV_TOP_ADDR that no longer answers,
+//  otherwise the next one after it.  So a board swapped in mid-chain takes the
+//  place of the one it replaced, and the slaves after it (which reset while the
+//  chain was open) come back one at a time on their old addresses.  Whatever the
+//  master knew about a reused address is dropped.
+//
+//****************************************************************************//
+#define HOTPLUG_POLL_INTERVAL_MS 50
+#define HOTPLUG_SETTLE_MS 10 //Time for the slave to move to its new address
+
+static uint32_t lastHotPlugPoll = 0;
+static uint8_t hotPlugScan = 0; //Next address to check for a gap while a slave waits (0 = none)
+static uint8_t hotPlugAddr = 0; //Address given out, waiting for settings (0 = none)
+
+static void tickHotPlug( void )
+{
+    uint8_t topAddr = readDevRegister( SCMD_SLV_TOP_ADDR );
+    
+    if(( readDevRegister( SCMD_MST_BG_CTRL ) & SCMD_BG_HOTPLUG_EN ) == 0 )
+    {
+        return;
+    }
+    if( hotPlugAddr != 0 )
+    {
+        //Last step: send settings, then add it to the frame
+        if((( sysTickMillis - lastHotPlugPoll ) < HOTPLUG_SETTLE_MS )||( requestExpansionSlot( TRAFFIC_DIAG, PUSH_CONFIG_WIRE_BYTES ) == false ))
+        {
+            return;
+        }
+        clearRemoteCacheSlave( hotPlugAddr );
+        clearSlaveMonitorEntry( hotPlugAddr );
+        pushSlaveConfig( hotPlugAddr );
+        if(( topAddr < START_SLAVE_ADDR )||( hotPlugAddr > topAddr ))
+        {
+            writeDevRegisterUnprotected( SCMD_SLV_TOP_ADDR, hotPlugAddr );
+        }
+        incrementDevRegister( SCMD_HOTPLUG_CNT );
+        hotPlugAddr = 0;
+        return;
+    }
+    if( hotPlugScan != 0 )
+    {
+        //Second step: find its address, one probe per pass
+        if( requestExpansionSlot( TRAFFIC_DIAG, XFER_BYTES_READ(1) + XFER_BYTES_WRITE(1) ) == false )
+        {
+            return;
+        }
+        if(( topAddr >= START_SLAVE_ADDR )&&( hotPlugScan <= topAddr )&&( ProbeSlaveData( hotPlugScan, SCMD_SLAVE_ADDR, &slaveData ) ))
+        {
+            //Still there
+            hotPlugScan++;
+            return;
+        }
+        if( hotPlugScan > MAX_SLAVE_ADDR )
+        {
+            //Chain is full, leave it waiting
+            hotPlugScan = 0;
+            return;
+        }
+        hotPlugAddr = hotPlugScan;
+        hotPlugScan = 0;
+        lastHotPlugPoll = sysTickMillis;
+        WriteSlaveData( POLL_ADDRESS, SCMD_SLAVE_ADDR, hotPlugAddr );
+        return;
+    }
+    if(( sysTickMillis - lastHotPlugPoll ) < HOTPLUG_POLL_INTERVAL_MS )
+    {
+        return;
+    }
+    if( requestExpansionSlot( TRAFFIC_DIAG, XFER_BYTES_READ(1) ) == false )
+    {
+        //The next frame is close
+        return;
+    }
+    lastHotPlugPoll = sysTickMillis;
+    
+    //First step: look for a ready slave
+    if(( ProbeSlaveData( POLL_ADDRESS, SCMD_SLAVE_ADDR, &slaveData ) == false )||( slaveData != POLL_ADDRESS ))
+    {
+        //Nobody waiting
+        return;
+    }
+    hotPlugScan = START_SLAVE_ADDR;
+}
+
+void tickMasterSM( void )
+{
     //Do master state machine
     uint8_t masterNextState = masterState;
     switch( masterState )
@@ -63,6 +390,14 @@ void tickMasterSM( void )
         writeDevRegister( SCMD_LOCAL_MASTER_LOCK, MASTER_LOCK_KEY );
 		
         slaveAddrEnumerator = START_SLAVE_ADDR;
+        CONFIG_OUT_Write(0);
+        //If the first slave still answers, only the master was reset.  Hold the chain
+        //low long enough that slaves waiting to rejoin reset instead.  (reEnumerate()
+        //has already held it low, fresh slaves don't answer yet.)
+        if( ProbeSlaveData( START_SLAVE_ADDR, SCMD_SLAVE_ADDR, &slaveData ) )
+        {
+            CyDelay( SLAVE_REJOIN_TIMEOUT_MS + 50 );
+        }
 		CONFIG_OUT_Write(1);
         writeDevRegister( SCMD_SLV_POLL_CNT, 0 );
 
@@ -99,9 +434,10 @@ void tickMasterSM( void )
         {
             //Must be done
 			setStatusBit( SCMD_ENUMERATION_BIT );  //Write "i'm done" bit
+            raiseEvent( SCMD_EVT_ENUM_DONE );
             writeDevRegister( SCMD_LOCAL_MASTER_LOCK, 0x00 );  //Lock up Read-Only registers -- we're done configuring the slaves!
 			uint8_t configTemp = readDevRegister( SCMD_CONFIG_BITS );
-			if((configTemp == 0) || (configTemp == 0x0D) || (configTemp == 0x0E)) //UART
+			if(ROLE_IS_UART(configTemp)) //UART
 			{
 				//Display a splash screen
 				USER_PORT_UartPutString("\r\nSparkFun Serial Controlled Motor Driver (SCMD)\r\n");
@@ -112,48 +448,31 @@ void tickMasterSM( void )
         CyDelay(10);
         break;
     case SCMDMasterWait:
+        //Keep the frame moving if the ISR callback didn't
+        serviceExpansionFrame();
         //Wait while tick counts
-        if( readDevRegister( SCMD_UPDATE_RATE ) != 0 )
+        if( driveFrameDue() )
         {
-            //Do this if packet rate not set to 0 (force mode)
-            if(masterSendCounter < readDevRegister( SCMD_UPDATE_RATE ))
-            {
-            }
-            else
-            {
-                masterNextState = SCMDMasterSendData;
-            }
+            masterNextState = SCMDMasterSendData;
+        }
+        else if( driveFrameDueSoon() )
+        {
+            //Hit the deadline exactly instead of at the next loop pass
+            while( driveFrameDue() == false );
+            masterNextState = SCMDMasterSendData;
         }
         else
         {
-            //force mode
-            if(readDevRegister( SCMD_FORCE_UPDATE ))
-            {
-                //clear force reg
-                writeDevRegister( SCMD_FORCE_UPDATE, 0 ); //This sets a busy bit
-                masterNextState = SCMDMasterSendData;
-            }
+            //Use the idle bus for background reads
+            tickSlaveFaults();
+            tickSlaveRejoin();
+            tickSlaveMonitor();
+            tickHotPlug();
         }
         break;
     case SCMDMasterSendData:
-        //Set output drive levels for master
-        PWM_1_WriteCompare( readDevRegister( SCMD_MA_DRIVE ) );
-        PWM_2_WriteCompare( readDevRegister( SCMD_MB_DRIVE ) ); 
-        for (slaveAddri = START_SLAVE_ADDR; slaveAddri <= readDevRegister(SCMD_SLV_TOP_ADDR); slaveAddri++)
-        {
-            //Write drive states out to slaves
-            WriteSlave2Data( slaveAddri, SCMD_MA_DRIVE, readDevRegister(SCMD_S1A_DRIVE + ((slaveAddri - START_SLAVE_ADDR) << 1 )), readDevRegister(SCMD_S1B_DRIVE + ((slaveAddri - START_SLAVE_ADDR) << 1 )) );
-            CyDelayUs(100);
-            
-        }
-        masterSendCounterReset = 1; //Request the ISR to reset the counter
-        while((masterSendCounter > 0)&&(breakCounterWait == false)); //Counter now = 0
-        breakCounterWait = false;
+        sendDriveFrame();
         masterNextState = SCMDMasterWait;
-        //*** TEMP CODE ***//
-        clearBusyBitMem( SCMD_FORCE_UPDATE );
-        //*** TEMP CODE ***//
-        
         break;
     default:
         break;
@@ -175,6 +494,7 @@ void tickMasterSM( void )
 		writeDevRegister( SCMD_UPDATE_RATE, readDevRegister( SCMD_UPDATE_RATE ));
 		writeDevRegister( SCMD_FORCE_UPDATE, readDevRegister( SCMD_FORCE_UPDATE ));
 		writeDevRegister( SCMD_FSAFE_TIME, readDevRegister( SCMD_FSAFE_TIME ));
+		resetExtSlaveShadow();
 	}
 }
 
@@ -198,12 +518,11 @@ void tickSlaveSM( void )
     case SCMDSlaveWaitForAddr:
         if(CONFIG_IN_Read() == 0)
         {
-            //CONFIG_IN went low (it shouldn't).  wait a bit and reboot
+            //CONFIG_IN went low before we got an address, nothing to keep.  Wait for it again.
 			CONFIG_OUT_Write(0);
-            CyDelay(100);
-            CySoftwareReset();
+            slaveNextState = SCMDSlaveWaitForSync;
         }
-        if( readDevRegister(SCMD_SLAVE_ADDR) != POLL_ADDRESS )
+        else if( readDevRegister(SCMD_SLAVE_ADDR) != POLL_ADDRESS )
         {
             //New address has been programmed
             CONFIG_OUT_Write(1);
@@ -214,10 +533,13 @@ void tickSlaveSM( void )
     case SCMDSlaveDone:
         if(CONFIG_IN_Read() == 0)
         {
-            //CONFIG_IN went low (it shouldn't).  wait a bit and reboot
+            //CONFIG_IN went low (it shouldn't).  Keep address and settings, but hold
+            //the outputs off and pass it down the chain until it comes back.
+            A_EN_Write( 0 );
+            B_EN_Write( 0 );
 			CONFIG_OUT_Write(0);
-            CyDelay(100);
-            CySoftwareReset();
+            rejoinStart = sysTickMillis;
+            slaveNextState = SCMDSlaveRejoin;
         }
         else
         {
@@ -226,6 +548,22 @@ void tickSlaveSM( void )
             PWM_2_WriteCompare( readDevRegister( SCMD_MB_DRIVE ) ); 
         }
         break;
+    case SCMDSlaveRejoin:
+        if( CONFIG_IN_Read() == 1 )
+        {
+            //Glitch is over, pick up where we left off
+            CONFIG_OUT_Write(1);
+            A_EN_Write( readDevRegister( SCMD_DRIVER_ENABLE ) & 0x01 );
+            B_EN_Write( readDevRegister( SCMD_DRIVER_ENABLE ) & 0x01 );
+            incrementDevRegister( SCMD_REJOIN_CNT );  //Master sees this and revalidates us
+            slaveNextState = SCMDSlaveDone;
+        }
+        else if(( sysTickMillis - rejoinStart ) > SLAVE_REJOIN_TIMEOUT_MS )
+        {
+            //Held low on purpose (master is re-enumerating), start over
+            CySoftwareReset();
+        }
+        break;
     default:
         break;
     }
@@ -257,15 +595,21 @@ void hardReset( void )
 void reEnumerate( void )
 {
 	clearStatusBit( SCMD_ENUMERATION_BIT );  //Clear "i'm done" bit
-    busyBitMemory = 0;  //Clear all busy bits
+    clearAllBusyBitMem();  //Clear all busy bits
     
     CyDelay(100u);
-    writeDevRegister( SCMD_LOCAL_USER_LOCK, USER_LOCK_KEY);
-    writeDevRegister( SCMD_LOCAL_MASTER_LOCK, MASTER_LOCK_KEY);
+    writeDevRegisterInternal( SCMD_LOCAL_USER_LOCK, USER_LOCK_KEY);
+    writeDevRegisterInternal( SCMD_LOCAL_MASTER_LOCK, MASTER_LOCK_KEY);
     
     //set slaveResetRequested to cause config transfer after re-enumeration
     slaveResetRequested = true;
     
+    //Chain may change, drop mirrored and cached slave data
+    clearSlaveMonitor();
+    clearRemoteCache();
+    hotPlugScan = 0;
+    hotPlugAddr = 0;
+    
     CONFIG_OUT_Write(0);
 
     //insert keys
@@ -25,4 +25,21 @@ bool masterSMDone( void );
 void hardReset( void );
 void reEnumerate( void );
 
+//Expansion bus traffic classes, highest priority first
+#define TRAFFIC_DRIVE 0
+#define TRAFFIC_CONFIG 1
+#define TRAFFIC_REMOTE 2
+#define TRAFFIC_DIAG 3
+
+void initDriveSchedule( void );
+bool driveFrameDue( void );
+uint32_t getFramePeriodTarget( void );
+void expansionPreempt( void );
+bool requestExpansionSlot( uint8_t trafficClass, uint8_t wireBytes );
+
+//Bytes on the bus for requestExpansionSlot(), address bytes included
+#define XFER_BYTES_WRITE(n) ( (n) + 2 ) //Address, offset, n data
+#define XFER_BYTES_READ(n) ( (n) + 3 ) //Address, offset, then address, n data
+#define PUSH_CONFIG_WIRE_BYTES ( XFER_BYTES_WRITE(3) + 2 * XFER_BYTES_WRITE(1) ) //pushSlaveConfig()
+
 #endif
\ No newline at end of file
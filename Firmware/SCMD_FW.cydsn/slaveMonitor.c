@@ -0,0 +1,264 @@
+/******************************************************************************
+slaveMonitor.c
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#include <stdint.h>
+#include <project.h>
+#include "devRegisters.h"
+#include "SCMD_config.h"
+#include "serial.h"
+#include "slaveMonitor.h"
+#include "slaveEnumeration.h"
+#include "registerHandlers.h"
+
+//Background slave telemetry
+//
+//While the master waits for the next frame it reads the health registers of
+//one slave at a time, round-robin, and mirrors them into the telemetry page.
+//Reads are diagnostic traffic (only started well before the next frame), and
+//run at most once per ms.
+
+#define SLAVE_MONITOR_SLAVES (MAX_SLAVE_ADDR - START_SLAVE_ADDR + 1)
+
+//One block covers SCMD_E_I2C_RD_ERR through SCMD_REG_RO_WRITE_CNT
+#define SLAVE_MONITOR_BLOCK_START SCMD_E_I2C_RD_ERR
+#define SLAVE_MONITOR_BLOCK_LENGTH (SCMD_REG_RO_WRITE_CNT - SCMD_E_I2C_RD_ERR + 1)
+
+static uint8_t telemetryTable[SLAVE_MONITOR_SLAVES * SCMD_TLM_STRIDE];
+
+//Slave rejoins
+//
+//Independent of telemetry, the master reads one slave's SCMD_REJOIN_CNT every
+//REJOIN_POLL_MS.  If it moved, the slave lost CONFIG_IN and rejoined, so its
+//settings are sent again.
+#define REJOIN_POLL_MS 10
+
+static uint8_t rejoinCounts[SLAVE_MONITOR_SLAVES];
+static uint8_t rejoinPollSlave = 0;
+static uint32_t lastRejoinPollTick = 0;
+
+//Slave faults
+//
+//Slaves latch faults in SCMD_FAULT_FLAGS.  The master reads a slave's flags after a
+//failed drive frame write to that slave, and on boards with the optional SLV_FAULT
+//line when the shared line is pulled low.  Without the line nothing in the data path
+//carries the fault, so the master reads one slave's flags every FAULT_POLL_MS, round
+//robin.  Collected flags are OR'd into the faults page and the slave's copy is cleared.
+#define FAULT_POLL_MS 10
+
+static uint8_t slaveFaults[SLAVE_MONITOR_SLAVES];
+static uint32_t faultCheckMask = 0; //Slaves waiting for a flag read
+static bool faultStatusSet = false;
+#if !defined(CY_PINS_SLV_FAULT_H)
+static uint8_t faultPollSlave = 0;
+static uint32_t lastFaultPollTick = 0;
+#endif
+static uint8_t nextSlave = 0;
+static uint32_t lastPollTick = 0;
+
+extern volatile uint32_t sysTickMillis;
+
+void initSlaveMonitor( void )
+{
+    clearSlaveMonitor();
+    //Doesn't fit one page, slaves 17 and up continue on the next
+    mapRegisterPage( SCMD_PAGE_TELEMETRY, telemetryTable, (SCMD_EXT_SLAVE_ADDR - START_SLAVE_ADDR) * SCMD_TLM_STRIDE, false );
+    mapRegisterPage( SCMD_PAGE_SLAVE_FAULTS, slaveFaults, SLAVE_MONITOR_SLAVES, true );
+    mapRegisterPage( SCMD_PAGE_TELEMETRY_EXT, &telemetryTable[(SCMD_EXT_SLAVE_ADDR - START_SLAVE_ADDR) * SCMD_TLM_STRIDE], (MAX_SLAVE_ADDR - SCMD_EXT_SLAVE_ADDR + 1) * SCMD_TLM_STRIDE, false );
+}
+
+void clearSlaveMonitor( void )
+{
+    uint16_t i;
+    for( i = 0; i < sizeof(telemetryTable); i++ )
+    {
+        telemetryTable[i] = 0;
+    }
+    for( i = 0; i < SLAVE_MONITOR_SLAVES; i++ )
+    {
+        rejoinCounts[i] = 0;
+        slaveFaults[i] = 0;
+    }
+    nextSlave = 0;
+    rejoinPollSlave = 0;
+    faultCheckMask = 0;
+#if !defined(CY_PINS_SLV_FAULT_H)
+    faultPollSlave = 0;
+#endif
+}
+
+void clearSlaveMonitorEntry( uint8_t address )
+{
+    uint8_t slave = address - START_SLAVE_ADDR;
+    uint8_t i;
+    if(( address < START_SLAVE_ADDR )||( address > MAX_SLAVE_ADDR ))
+    {
+        return;
+    }
+    for( i = 0; i < SCMD_TLM_STRIDE; i++ )
+    {
+        telemetryTable[slave * SCMD_TLM_STRIDE + i] = 0;
+    }
+    rejoinCounts[slave] = 0;
+    slaveFaults[slave] = 0;
+    faultCheckMask &= ~( 1ul << slave );
+}
+
+void tickSlaveFaults( void )
+{
+    uint8_t topAddr = readDevRegister( SCMD_SLV_TOP_ADDR );
+    uint32_t frameFaults = takeFrameFaults();
+    uint8_t flags;
+    uint8_t i;
+    bool anyFaults = false;
+    
+    for( i = 0; i < SLAVE_MONITOR_SLAVES; i++ )
+    {
+        if( frameFaults & ( 1ul << i ) )
+        {
+            slaveFaults[i] |= SCMD_FAULT_NO_ACK;
+        }
+    }
+    faultCheckMask |= frameFaults;
+#if defined(CY_PINS_SLV_FAULT_H)
+    if(( SLV_FAULT_Read() == 0 )&&( faultCheckMask == 0 )&&( topAddr >= START_SLAVE_ADDR ))
+    {
+        //Somebody is alerting, ask everyone
+        faultCheckMask = ( 2ul << ( topAddr - START_SLAVE_ADDR )) - 1;
+    }
+#else
+    if(( faultCheckMask == 0 )&&( topAddr >= START_SLAVE_ADDR )&&( (uint32_t)( sysTickMillis - lastFaultPollTick ) >= FAULT_POLL_MS ))
+    {
+        //No alert line, poll
+        lastFaultPollTick = sysTickMillis;
+        if( START_SLAVE_ADDR + faultPollSlave > topAddr ) faultPollSlave = 0;
+        faultCheckMask = 1ul << faultPollSlave;
+        faultPollSlave++;
+    }
+#endif
+    if(( faultCheckMask != 0 )&&( requestExpansionSlot( TRAFFIC_REMOTE, XFER_BYTES_READ(1) + XFER_BYTES_WRITE(1) ) ))
+    {
+        for( i = 0; ( faultCheckMask & ( 1ul << i )) == 0; i++ );
+        faultCheckMask &= ~( 1ul << i );
+        if(( START_SLAVE_ADDR + i <= topAddr )&&( ProbeSlaveData( START_SLAVE_ADDR + i, SCMD_FAULT_FLAGS, &flags ) )&&( flags != 0 ))
+        {
+            slaveFaults[i] |= flags;
+            WriteSlaveData( START_SLAVE_ADDR + i, SCMD_FAULT_FLAGS, 0 );
+        }
+    }
+    
+    //Status bit follows the page (host clears the page to clear it)
+    for( i = 0; i < SLAVE_MONITOR_SLAVES; i++ )
+    {
+        if( slaveFaults[i] ) anyFaults = true;
+    }
+    if( anyFaults != faultStatusSet )
+    {
+        faultStatusSet = anyFaults;
+        if( anyFaults )
+        {
+            setStatusBit( SCMD_SLV_FAULT_BIT );
+            raiseEvent( SCMD_EVT_SLV_FAULT );
+        }
+        else
+        {
+            clearStatusBit( SCMD_SLV_FAULT_BIT );
+        }
+    }
+}
+
+void tickSlaveMonitor( void )
+{
+    uint8_t block[SLAVE_MONITOR_BLOCK_LENGTH];
+    uint8_t topAddr = readDevRegister( SCMD_SLV_TOP_ADDR );
+    uint32_t tick = sysTickMillis;
+    
+    if(( readDevRegister( SCMD_MST_BG_CTRL ) & SCMD_BG_TELEMETRY_EN ) == 0 )
+    {
+        return;
+    }
+    if(( topAddr < START_SLAVE_ADDR )||( topAddr > MAX_SLAVE_ADDR ))
+    {
+        //No slaves
+        return;
+    }
+    //Stay clear of the next frame
+    if( requestExpansionSlot( TRAFFIC_DIAG, XFER_BYTES_READ(SLAVE_MONITOR_BLOCK_LENGTH) ) == false )
+    {
+        return;
+    }
+    if( tick == lastPollTick )
+    {
+        return;
+    }
+    lastPollTick = tick;
+    
+    if( nextSlave > topAddr - START_SLAVE_ADDR )
+    {
+        nextSlave = 0;
+    }
+    if( ReadSlaveBlock( START_SLAVE_ADDR + nextSlave, SLAVE_MONITOR_BLOCK_START, block, SLAVE_MONITOR_BLOCK_LENGTH ) == SLAVE_MONITOR_BLOCK_LENGTH )
+    {
+        uint8_t * entry = &telemetryTable[nextSlave * SCMD_TLM_STRIDE];
+        entry[SCMD_TLM_E_I2C_RD_ERR] = block[SCMD_E_I2C_RD_ERR - SLAVE_MONITOR_BLOCK_START];
+        entry[SCMD_TLM_E_I2C_WR_ERR] = block[SCMD_E_I2C_WR_ERR - SLAVE_MONITOR_BLOCK_START];
+        entry[SCMD_TLM_LOOP_TIME] = block[SCMD_LOOP_TIME - SLAVE_MONITOR_BLOCK_START];
+        entry[SCMD_TLM_FSAFE_FAULTS] = block[SCMD_FSAFE_FAULTS - SLAVE_MONITOR_BLOCK_START];
+        entry[SCMD_TLM_REG_OOR_CNT] = block[SCMD_REG_OOR_CNT - SLAVE_MONITOR_BLOCK_START];
+        entry[SCMD_TLM_REG_RO_WRITE_CNT] = block[SCMD_REG_RO_WRITE_CNT - SLAVE_MONITOR_BLOCK_START];
+    }
+    nextSlave++;
+}
+
+void tickSlaveRejoin( void )
+{
+    uint8_t topAddr = readDevRegister( SCMD_SLV_TOP_ADDR );
+    uint8_t rejoinCount;
+    
+    if(( topAddr < START_SLAVE_ADDR )||( topAddr > MAX_SLAVE_ADDR ))
+    {
+        //No slaves
+        return;
+    }
+    if( (uint32_t)( sysTickMillis - lastRejoinPollTick ) < REJOIN_POLL_MS )
+    {
+        return;
+    }
+    if( requestExpansionSlot( TRAFFIC_DIAG, XFER_BYTES_READ(1) ) == false )
+    {
+        return;
+    }
+    lastRejoinPollTick = sysTickMillis;
+    
+    if( rejoinPollSlave > topAddr - START_SLAVE_ADDR )
+    {
+        rejoinPollSlave = 0;
+    }
+    if(( ProbeSlaveData( START_SLAVE_ADDR + rejoinPollSlave, SCMD_REJOIN_CNT, &rejoinCount ) )&&( rejoinCount != rejoinCounts[rejoinPollSlave] ))
+    {
+        //Slave rejoined, make sure it has current settings.  Sent on a later
+        //pass if there's no room before the next frame.
+        if( requestExpansionSlot( TRAFFIC_DIAG, PUSH_CONFIG_WIRE_BYTES ) )
+        {
+            rejoinCounts[rejoinPollSlave] = rejoinCount;
+            pushSlaveConfig( START_SLAVE_ADDR + rejoinPollSlave );
+            incrementDevRegister( SCMD_REJOIN_CNT );
+        }
+        else
+        {
+            //Come back to this one
+            return;
+        }
+    }
+    rejoinPollSlave++;
+}
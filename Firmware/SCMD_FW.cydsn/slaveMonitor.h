@@ -0,0 +1,27 @@
+/******************************************************************************
+slaveMonitor.h
+Serial controlled motor driver firmware
+marshall.taylor@sparkfun.com
+7-8-2016
+https://github.com/sparkfun/Serial_Controlled_Motor_Driver/
+
+See github readme for mor information.
+
+This code is released under the [MIT License](http://opensource.org/licenses/MIT).
+Please review the LICENSE.md file included with this example. If you have any questions 
+or concerns with licensing, please contact techsupport@sparkfun.com.
+Distributed as-is; no warranty is given.
+******************************************************************************/
+#if !defined(SLAVEMONITOR_H)
+#define SLAVEMONITOR_H
+#include <stdint.h> 
+#include <stdbool.h>
+
+void initSlaveMonitor( void );
+void tickSlaveMonitor( void ); //Call from idle expansion bus time only (master wait state)
+void clearSlaveMonitor( void ); //Drop mirrored data, use when the chain changes
+void clearSlaveMonitorEntry( uint8_t address ); //Drop one slave's mirrored data and faults
+void tickSlaveFaults( void ); //Master wait state, collects faults from alerting slaves
+void tickSlaveRejoin( void ); //Master wait state, resends settings to slaves that rejoined
+
+#endif
@@ -67,6 +67,10 @@ SCMD::SCMD( void )
 	settings.I2CAddress = 0x58; //Ignored for SPI_MODE
 	//Select default SPI CS pin.
 	settings.chipSelectPin = 10; //Ignored for I2C_MODE
+	//No alert line by default, waits poll the status register
+	settings.alertPin = SCMD_NO_ALERT_PIN;
+	//Single register transfers until begin() has read the capability page
+	capabilities = 0;
 
 }
 
@@ -115,12 +119,53 @@ uint8_t SCMD::begin( void )
 		break;
 	}
 	
+	if( settings.alertPin != SCMD_NO_ALERT_PIN )
+	{
+		//HOST_ALERT is open drain, active low
+		pinMode(settings.alertPin, INPUT_PULLUP);
+	}
+	
 	//dummy read
 	readRegister(SCMD_ID);
 	
+	//Ask the firmware what it supports, the transfers below go by the flags.
+	//Firmware without the capability page keeps single register transfers.
+	capabilities = 0;
+	uint8_t caps[SCMD_CAP_LENGTH];
+	if( readCapabilities( caps ) )
+	{
+		capabilities = caps[SCMD_CAP_FLAGS_L] | ((uint16_t)caps[SCMD_CAP_FLAGS_H] << 8);
+		if(( settings.commInterface == I2C_MODE )&&( caps[SCMD_CAP_U_I2C_SPEED] >= 4 ))
+		{
+			Wire.setClock(400000);
+		}
+	}
+	
 	return readRegister(SCMD_ID);
 }
 
+//readCapabilities( ... )
+//
+//    Read the capability page.  Returns 0 (and leaves caps alone) if the firmware
+//  is older than the page.
+//
+//  uint8_t * caps -- SCMD_CAP_LENGTH bytes, SCMD_CAP_* layout
+bool SCMD::readCapabilities( uint8_t * caps )
+{
+	if( readRegister(SCMD_FID) < SCMD_CAP_FIRST_FID )
+	{
+		return false;
+	}
+	readPage( SCMD_PAGE_CAPS, 0, caps, SCMD_CAP_LENGTH );
+	return ( caps[SCMD_CAP_VERSION] >= SCMD_CAP_FORMAT );
+}
+
+//check if the firmware has all of the SCMD_CAP_ bits, known after begin()
+bool SCMD::hasCapability( uint16_t flags )
+{
+	return (( capabilities & flags ) == flags );
+}
+
 //check if enumeration is complete
 bool SCMD::ready( void )
 {
@@ -156,6 +201,127 @@ bool SCMD::busy( void )
 	}
 
 }
+//alertPinUsable()
+//
+//    The alert pin is only watched if one is configured and the firmware drives
+//  HOST_ALERT (SCMD_CAP_HOST_ALERT), otherwise waits poll the bus.
+bool SCMD::alertPinUsable( void )
+{
+	return ( settings.alertPin != SCMD_NO_ALERT_PIN )&&( hasCapability(SCMD_CAP_HOST_ALERT) );
+}
+
+//remoteQueueUsable()
+//
+//    The queued remote ops need the SCMD_REMQ_* registers and the results page
+//  (SCMD_CAP_REMOTE_QUEUE and SCMD_CAP_PAGING).
+bool SCMD::remoteQueueUsable( void )
+{
+	return hasCapability( SCMD_CAP_REMOTE_QUEUE | SCMD_CAP_PAGING );
+}
+
+//waitForEvent( ... )
+//
+//    Waits for any of the requested events to latch.  With a usable alert pin this
+//  idles on the pin instead of the bus, adding the events to SCMD_EVENT_MASK (bits
+//  already in the mask are kept).  The events seen are cleared before returning.
+//
+//  uint8_t eventMask -- SCMD_EVT_ bits to wait for
+//  uint16_t timeoutMs -- Give up after this long
+uint8_t SCMD::waitForEvent( uint8_t eventMask, uint16_t timeoutMs )
+{
+	bool usePin = alertPinUsable();
+	if( usePin )
+	{
+		uint8_t mask = readRegister(SCMD_EVENT_MASK);
+		if(( mask & eventMask ) != eventMask )
+		{
+			writeRegister(SCMD_EVENT_MASK, mask | eventMask);
+		}
+	}
+	uint32_t startTime = millis();
+	uint8_t events = 0;
+	while( events == 0 )
+	{
+		if( (uint16_t)(millis() - startTime) >= timeoutMs )
+		{
+			return 0;
+		}
+		if(( usePin == false )||( digitalRead(settings.alertPin) == LOW ))
+		{
+			events = readRegister(SCMD_EVENT_FLAGS) & eventMask;
+		}
+	}
+	writeRegister(SCMD_EVENT_FLAGS, events);
+	return events;
+}
+
+//saveConfig and clearConfig run from SCMD_CONTROL_1 (user lockable).  The master
+//pauses for a few ms while flash is programmed.  A saved UART baud is ignored at
+//boot when the jumpers select 57600 or 115200.
+bool SCMD::saveConfig( void )
+{
+	writeRegister(SCMD_CONTROL_1, SCMD_SAVE_CONFIG_BIT);
+	while( readRegister(SCMD_CONTROL_1) & SCMD_SAVE_CONFIG_BIT );
+	return ( readRegister(SCMD_CONFIG_STATUS) & SCMD_CFG_SAVED ) != 0;
+}
+
+bool SCMD::clearConfig( void )
+{
+	writeRegister(SCMD_CONTROL_1, SCMD_CLEAR_CONFIG_BIT);
+	while( readRegister(SCMD_CONTROL_1) & SCMD_CLEAR_CONFIG_BIT );
+	return ( readRegister(SCMD_CONFIG_STATUS) & SCMD_CFG_FAILED ) == 0;
+}
+
+//exportConfig and importConfig move the saved settings as one SCMD_BLOB_SIZE block.
+//The blob carries its own version and CRC, keep it as is.  An import is checked
+//and applied at once, then importConfig waits (up to timeoutMs) for the slaves to
+//be sent theirs.  Changing the UART baud needs the master lock opened first.
+bool SCMD::exportConfig( uint8_t * blob )
+{
+	uint8_t ctrl = SCMD_BLOB_EXPORT;
+	writePage( SCMD_PAGE_CONFIG_BLOB, SCMD_BLOB_CTRL, &ctrl, 1 );
+	readPage( SCMD_PAGE_CONFIG_BLOB, 0, blob, SCMD_BLOB_SIZE );
+	return blob[SCMD_BLOB_VERSION] == SCMD_BLOB_FORMAT;
+}
+
+bool SCMD::importConfig( const uint8_t * blob, uint16_t timeoutMs )
+{
+	uint8_t data[SCMD_BLOB_SIZE + 1];
+	uint8_t i;
+	for( i = 0; i < SCMD_BLOB_SIZE; i++ )
+	{
+		data[i] = blob[i];
+	}
+	data[SCMD_BLOB_CTRL] = SCMD_BLOB_IMPORT;
+	writePage( SCMD_PAGE_CONFIG_BLOB, 0, data, SCMD_BLOB_SIZE + 1 );
+	if(( readRegister(SCMD_CONFIG_STATUS) & SCMD_CFG_IMPORTED ) == 0 ) return false;
+	//Applied, wait for the slaves to be sent theirs
+	uint32_t startTime = millis();
+	do
+	{
+		if( (uint16_t)(millis() - startTime) >= timeoutMs )
+		{
+			return false;
+		}
+		readPage( SCMD_PAGE_CONFIG_BLOB, SCMD_BLOB_CTRL, &i, 1 );
+	} while( i & SCMD_BLOB_IMPORT );
+	return true;
+}
+
+//Async register writes (inversion, bridging, enable, locks, failsafe time, remote
+//access) are numbered.  Read the number after the write, then check it instead of
+//busy() so several changes can be in flight at once.
+uint8_t SCMD::lastOperation( void )
+{
+	return readRegister(SCMD_OP_SEQ);
+}
+
+bool SCMD::operationDone( uint8_t sequence )
+{
+	//Sequences wrap, compare by distance
+	return (int8_t)(readRegister(SCMD_OP_DONE) - sequence) >= 0;
+}
+
 //Enable and disable functions.  Call after begin to enable the h-bridges
 void SCMD::enable( void )
 {
@@ -192,33 +358,39 @@ void SCMD::reset( void )
 //
 //    Drive a motor at a level
 //
-//  uint8_t motorNum -- Motor number from 0 to 33
+//  uint16_t motorNum -- Motor number from 0 to 65 (34 and up are on the extended slave page)
 //  uint8_t direction -- 0 or 1 for forward and backward
 //  uint8_t level -- 0 to 255 for drive strength
-void SCMD::setDrive( uint8_t motorNum, uint8_t direction, uint8_t level )
+void SCMD::setDrive( uint16_t motorNum, uint8_t direction, uint8_t level )
 {
 	//convert to 7 bit
 	level = level >> 1;
 	int16_t driveValue; //use to build value to actually write to register
 	
+	driveValue = (level * direction) + ((int8_t)level * ((int8_t)direction - 1)); //set to 1/2 drive if direction = 1 or -1/2 drive if direction = 0; (level * direction);
+	driveValue += 128;
 	//Make sure the motor number is valid
-	if(motorNum < 34)
+	if(motorNum < SCMD_EXT_FIRST_MOTOR)
 	{
-		driveValue = (level * direction) + ((int8_t)level * ((int8_t)direction - 1)); //set to 1/2 drive if direction = 1 or -1/2 drive if direction = 0; (level * direction);
-		driveValue += 128;
 		writeRegister(SCMD_MA_DRIVE + motorNum, driveValue);
 	}
+	else if(motorNum < SCMD_EXT_FIRST_MOTOR + SCMD_EXT_INV)
+	{
+		uint8_t driveByte = driveValue;
+		writePage( SCMD_PAGE_EXT_SLAVES, SCMD_EXT_DRIVE + motorNum - SCMD_EXT_FIRST_MOTOR, &driveByte, 1 );
+	}
 }
 
 //inversionMode( ... )
 //
 //    Configure a motor's direction inversion
 //
-//  uint8_t motorNum -- Motor number from 0 to 33
+//  uint16_t motorNum -- Motor number from 0 to 65
 //  uint8_t polarity -- 0 or 1 for default or inverted
-void SCMD::inversionMode( uint8_t motorNum, uint8_t polarity )
+void SCMD::inversionMode( uint16_t motorNum, uint8_t polarity )
 {
 	uint8_t regTemp;
+	uint8_t pageTemp = 0;
 	//Select target register
 	if( motorNum < 2 )
 	{
@@ -253,14 +425,26 @@ void SCMD::inversionMode( uint8_t motorNum, uint8_t polarity )
 			regTemp = SCMD_INV_26_33;
 			motorNum -= 26;
 		}
+		else if( motorNum < SCMD_EXT_FIRST_MOTOR + SCMD_EXT_INV )
+		{
+			//extended slave page, 8 per byte from SCMD_EXT_INV
+			pageTemp = SCMD_PAGE_EXT_SLAVES;
+			motorNum -= SCMD_EXT_FIRST_MOTOR;
+			regTemp = SCMD_EXT_INV + (motorNum >> 3);
+			motorNum &= 0x07;
+		}
 		else
 		{
 			//out of range
 			return;
 		}
 		//convert motorNum to one-hot mask
-		uint8_t data = readRegister( regTemp ) & ~( 1 << motorNum );
-		writeRegister( regTemp, data | ((polarity & 0x01) << motorNum) );
+		uint8_t data;
+		if( pageTemp ) readPage( pageTemp, regTemp, &data, 1 );
+		else data = readRegister( regTemp );
+		data = ( data & ~( 1 << motorNum )) | ((polarity & 0x01) << motorNum);
+		if( pageTemp ) writePage( pageTemp, regTemp, &data, 1 );
+		else writeRegister( regTemp, data );
 	}
 
 }
@@ -269,11 +453,12 @@ void SCMD::inversionMode( uint8_t motorNum, uint8_t polarity )
 //
 //    Configure a driver's bridging state
 //
-//  uint8_t driverNum -- Number of driver.  Master is 0, slave 1 is 1, etc.  0 to 16
+//  uint16_t driverNum -- Number of driver.  Master is 0, slave 1 is 1, etc.  0 to 32
 //  uint8_t bridged -- 0 or 1 for forward and backward
-void SCMD::bridgingMode( uint8_t driverNum, uint8_t bridged )
+void SCMD::bridgingMode( uint16_t driverNum, uint8_t bridged )
 {
 	uint8_t regTemp;
+	uint8_t pageTemp = 0;
 	//Select target register
 	if( driverNum < 1 )
 	{
@@ -295,18 +480,43 @@ void SCMD::bridgingMode( uint8_t driverNum, uint8_t bridged )
 			regTemp = SCMD_BRIDGE_SLV_H;
 			driverNum -= 9;
 		}
+		else if( driverNum <= MAX_SLAVE_ADDR - START_SLAVE_ADDR + 1 )
+		{
+			//extended slave page, 8 per byte from SCMD_EXT_BRIDGE
+			pageTemp = SCMD_PAGE_EXT_SLAVES;
+			driverNum -= 17;
+			regTemp = SCMD_EXT_BRIDGE + (driverNum >> 3);
+			driverNum &= 0x07;
+		}
 		else
 		{
 			//out of range
 			return;
 		}
 		//convert driverNum to one-hot mask
-		uint8_t data = readRegister( regTemp ) & ~( 1 << driverNum );
-		writeRegister( regTemp, data | ((bridged & 0x01) << driverNum) );
+		uint8_t data;
+		if( pageTemp ) readPage( pageTemp, regTemp, &data, 1 );
+		else data = readRegister( regTemp );
+		data = ( data & ~( 1 << driverNum )) | ((bridged & 0x01) << driverNum);
+		if( pageTemp ) writePage( pageTemp, regTemp, &data, 1 );
+		else writeRegister( regTemp, data );
 	}
 	
 }
 
+//updateDivisor( ... )
+//
+//    Send a slave's drive levels every n-th frame only, leaving bus time for the others
+//
+//  uint8_t driverNum -- Number of slave driver, 1 to 32
+//  uint8_t divisor -- 0 or 1 for every frame, up to 255
+void SCMD::updateDivisor( uint8_t driverNum, uint8_t divisor )
+{
+	if(( driverNum < 1 )||( driverNum > MAX_SLAVE_ADDR - START_SLAVE_ADDR + 1 )) return;
+	if( !hasCapability(SCMD_CAP_PAGING) ) return;
+	writePage( SCMD_PAGE_SLAVE_DIV, driverNum - 1, &divisor, 1 );
+}
+
 //****************************************************************************//
 //
 //  Diagnostics
@@ -346,7 +556,7 @@ void SCMD::getDiagnostics( SCMDDiagnostics &diagObjectReference )
 //
 //    Get diagnostic information from a slave
 //
-//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x5F for slave 1 to 16.
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
 //  SCMDDiagnostics &diagObjectReference -- Object to contain returned data
 void SCMD::getRemoteDiagnostics( uint8_t address, SCMDDiagnostics &diagObjectReference )
 {
@@ -366,6 +576,183 @@ void SCMD::getRemoteDiagnostics( uint8_t address, SCMDDiagnostics &diagObjectRef
 	
 }
 
+//getMirroredDiagnostics( ... )
+//
+//    Get diagnostic information for a slave from the master's telemetry page.
+//  The master refreshes this in the background, so no remote reads are done.
+//
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
+//  SCMDDiagnostics &diagObjectReference -- Object to contain returned data
+void SCMD::getMirroredDiagnostics( uint8_t address, SCMDDiagnostics &diagObjectReference )
+{
+	uint8_t entry[SCMD_TLM_STRIDE];
+	if(( address < START_SLAVE_ADDR )||( address > MAX_SLAVE_ADDR )) return;
+	if( address < SCMD_EXT_SLAVE_ADDR )
+	{
+		readPage( SCMD_PAGE_TELEMETRY, (address - START_SLAVE_ADDR) * SCMD_TLM_STRIDE, entry, SCMD_TLM_STRIDE );
+	}
+	else
+	{
+		readPage( SCMD_PAGE_TELEMETRY_EXT, (address - SCMD_EXT_SLAVE_ADDR) * SCMD_TLM_STRIDE, entry, SCMD_TLM_STRIDE );
+	}
+	
+	diagObjectReference.numberOfSlaves = 0;
+	diagObjectReference.U_I2C_RD_ERR = 0;
+	diagObjectReference.U_I2C_WR_ERR = 0;
+	diagObjectReference.U_BUF_DUMPED = 0;
+	diagObjectReference.E_I2C_RD_ERR = entry[SCMD_TLM_E_I2C_RD_ERR];
+	diagObjectReference.E_I2C_WR_ERR = entry[SCMD_TLM_E_I2C_WR_ERR];
+	diagObjectReference.LOOP_TIME = entry[SCMD_TLM_LOOP_TIME];
+	diagObjectReference.SLV_POLL_CNT = 0;
+	diagObjectReference.MST_E_ERR = 0;
+	diagObjectReference.MST_E_STATUS = 0;
+	diagObjectReference.FSAFE_FAULTS = entry[SCMD_TLM_FSAFE_FAULTS];
+	diagObjectReference.REG_OOR_CNT = entry[SCMD_TLM_REG_OOR_CNT];
+	diagObjectReference.REG_RO_WRITE_CNT = entry[SCMD_TLM_REG_RO_WRITE_CNT];
+	
+}
+
+//Little endian 32 bit value from a page buffer
+static uint32_t getWord32( const uint8_t * data )
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+//getWideDiagnostics( ... )
+//
+//    Get the master's 32 bit counters.  They are latched together first, so the
+//  set is consistent even though it takes more than one read.
+//
+//  SCMDWideDiagnostics &diagObjectReference -- Object to contain returned data
+//  bool clearAfter -- Zero the counters in the same step as the latch
+void SCMD::getWideDiagnostics( SCMDWideDiagnostics &diagObjectReference, bool clearAfter )
+{
+	uint8_t snapshot[SCMD_DIAG_LENGTH];
+	uint8_t half = SCMD_DIAG_LENGTH / 2;
+	writeRegister( SCMD_DIAG_LATCH, SCMD_DIAG_SNAP | ( clearAfter ? SCMD_DIAG_CLEAR : 0 ) );
+	//Reads are limited to 32 bytes
+	readPage( SCMD_PAGE_DIAG, 0, snapshot, half );
+	readPage( SCMD_PAGE_DIAG, half, &snapshot[half], SCMD_DIAG_LENGTH - half );
+	
+	diagObjectReference.U_I2C_RD_ERR = getWord32( &snapshot[SCMD_DIAG_U_I2C_RD_ERR] );
+	diagObjectReference.U_I2C_WR_ERR = getWord32( &snapshot[SCMD_DIAG_U_I2C_WR_ERR] );
+	diagObjectReference.U_BUF_DUMPED = getWord32( &snapshot[SCMD_DIAG_U_BUF_DUMPED] );
+	diagObjectReference.E_I2C_RD_ERR = getWord32( &snapshot[SCMD_DIAG_E_I2C_RD_ERR] );
+	diagObjectReference.E_I2C_WR_ERR = getWord32( &snapshot[SCMD_DIAG_E_I2C_WR_ERR] );
+	diagObjectReference.SLV_POLL_CNT = getWord32( &snapshot[SCMD_DIAG_SLV_POLL_CNT] );
+	diagObjectReference.MST_E_ERR = getWord32( &snapshot[SCMD_DIAG_MST_E_ERR] );
+	diagObjectReference.FSAFE_FAULTS = getWord32( &snapshot[SCMD_DIAG_FSAFE_FAULTS] );
+	diagObjectReference.REG_OOR_CNT = getWord32( &snapshot[SCMD_DIAG_REG_OOR_CNT] );
+	diagObjectReference.REG_RO_WRITE_CNT = getWord32( &snapshot[SCMD_DIAG_REG_RO_WRITE_CNT] );
+	diagObjectReference.FRAME_LATE_CNT = getWord32( &snapshot[SCMD_DIAG_FRAME_LATE_CNT] );
+	diagObjectReference.HOTPLUG_CNT = getWord32( &snapshot[SCMD_DIAG_HOTPLUG_CNT] );
+	diagObjectReference.REJOIN_CNT = getWord32( &snapshot[SCMD_DIAG_REJOIN_CNT] );
+	diagObjectReference.latchTime = getWord32( &snapshot[SCMD_DIAG_LATCH_TIME] );
+	
+}
+
+//getChangedRegisters( ... )
+//
+//    Read which registers changed since they were last acknowledged, in one burst.
+//  The generation counts every change (wrapping), so a host can skip this read
+//  entirely while it hasn't moved.
+//
+//  uint8_t * bitmap -- 16 bytes, register n is bit (n % 8) of byte (n / 8)
+uint16_t SCMD::getChangedRegisters( uint8_t * bitmap )
+{
+	uint8_t data[SCMD_CHG_LENGTH];
+	uint8_t i;
+	readPage( SCMD_PAGE_CHANGES, 0, data, SCMD_CHG_LENGTH );
+	for( i = 0; i < SCMD_CHG_LENGTH - SCMD_CHG_BITMAP; i++ )
+	{
+		bitmap[i] = data[SCMD_CHG_BITMAP + i];
+	}
+	return data[SCMD_CHG_GEN_L] | ((uint16_t)data[SCMD_CHG_GEN_H] << 8);
+}
+
+//ackChangedRegisters( ... )
+//
+//    Clear changed bits.  Do this before reading the registers so a change while
+//  reading shows up again next time.
+//
+//  const uint8_t * bitmap -- 16 bytes, as from getChangedRegisters()
+void SCMD::ackChangedRegisters( const uint8_t * bitmap )
+{
+	writePage( SCMD_PAGE_CHANGES, SCMD_CHG_BITMAP, bitmap, SCMD_CHG_LENGTH - SCMD_CHG_BITMAP );
+}
+
+//readAccessStats( ... )
+//
+//    Read how often the host has read and written registers.  Only available
+//  when the firmware is built with REGISTER_ACCESS_STATS, otherwise all 0.
+//
+//  uint8_t firstRegister -- First of SCMD_AST_WINDOW_REGS registers to get
+//  uint16_t * reads -- SCMD_AST_WINDOW_REGS read counts
+//  uint16_t * writes -- SCMD_AST_WINDOW_REGS write counts
+void SCMD::readAccessStats( uint8_t firstRegister, uint16_t * reads, uint16_t * writes )
+{
+	uint8_t data[SCMD_AST_WINDOW_STRIDE * SCMD_AST_WINDOW_REGS];
+	uint8_t half = sizeof(data) / 2;
+	uint8_t i;
+	uint8_t ctrl = firstRegister;
+	writePage( SCMD_PAGE_ACCESS_STATS, SCMD_AST_CTRL, &ctrl, 1 );
+	//Reads are limited to 32 bytes
+	readPage( SCMD_PAGE_ACCESS_STATS, SCMD_AST_WINDOW, data, half );
+	readPage( SCMD_PAGE_ACCESS_STATS, SCMD_AST_WINDOW + half, &data[half], half );
+	for( i = 0; i < SCMD_AST_WINDOW_REGS; i++ )
+	{
+		reads[i] = data[i * SCMD_AST_WINDOW_STRIDE] | ((uint16_t)data[(i * SCMD_AST_WINDOW_STRIDE) + 1] << 8);
+		writes[i] = data[(i * SCMD_AST_WINDOW_STRIDE) + 2] | ((uint16_t)data[(i * SCMD_AST_WINDOW_STRIDE) + 3] << 8);
+	}
+}
+
+//getHotRegisters( ... )
+//
+//    Get the registers the host accesses most (REGISTER_ACCESS_STATS firmware)
+//
+//  uint8_t * registers -- SCMD_AST_HOT_COUNT register numbers, most hit first
+//  uint16_t * hits -- SCMD_AST_HOT_COUNT reads plus writes of each
+void SCMD::getHotRegisters( uint8_t * registers, uint16_t * hits )
+{
+	uint8_t data[SCMD_AST_HOT_STRIDE * SCMD_AST_HOT_COUNT];
+	uint8_t i;
+	uint8_t ctrl = 0;
+	writePage( SCMD_PAGE_ACCESS_STATS, SCMD_AST_CTRL, &ctrl, 1 );
+	readPage( SCMD_PAGE_ACCESS_STATS, SCMD_AST_HOT, data, sizeof(data) );
+	for( i = 0; i < SCMD_AST_HOT_COUNT; i++ )
+	{
+		registers[i] = data[i * SCMD_AST_HOT_STRIDE];
+		hits[i] = data[(i * SCMD_AST_HOT_STRIDE) + 1] | ((uint16_t)data[(i * SCMD_AST_HOT_STRIDE) + 2] << 8);
+	}
+}
+
+//resetAccessStats( ... )
+//
+//    Zero the host access counts
+//
+void SCMD::resetAccessStats( void )
+{
+	uint8_t ctrl = SCMD_AST_RESET;
+	writePage( SCMD_PAGE_ACCESS_STATS, SCMD_AST_CTRL, &ctrl, 1 );
+}
+
+//getSlaveFaults( ... )
+//
+//    Get the faults the master has collected from a slave (SCMD_FAULT_* bits), and clear them.
+//  SCMD_SLV_FAULT_BIT in SCMD_STATUS_1 is set while any slave has faults.
+//
+//  uint8_t address -- Address of slave.  Can be 0x50 to 0x6F for slave 1 to 32.
+uint8_t SCMD::getSlaveFaults( uint8_t address )
+{
+	uint8_t faults;
+	uint8_t clear = 0;
+	if(( address < START_SLAVE_ADDR )||( address > MAX_SLAVE_ADDR )) return 0;
+	if( !hasCapability(SCMD_CAP_PAGING) ) return 0;
+	readPage( SCMD_PAGE_SLAVE_FAULTS, address - START_SLAVE_ADDR, &faults, 1 );
+	if( faults ) writePage( SCMD_PAGE_SLAVE_FAULTS, address - START_SLAVE_ADDR, &clear, 1 );
+	return faults;
+}
+
 //resetDiagnosticCounts( ... )
 //
 //    Reset the master's diagnostic counters
@@ -383,6 +770,7 @@ void SCMD::resetDiagnosticCounts( void )
 	writeRegister( SCMD_FSAFE_FAULTS, 0 );
 	writeRegister( SCMD_REG_OOR_CNT, 0 );
 	writeRegister( SCMD_REG_RO_WRITE_CNT, 0 );
+	writeRegister( SCMD_DIAG_LATCH, SCMD_DIAG_CLEAR );
 	
 }
 
@@ -390,7 +778,7 @@ void SCMD::resetDiagnosticCounts( void )
 //
 //    Reset a slave's diagnostic counters
 //
-//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x5F for slave 1 to 16.
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
 void SCMD::resetRemoteDiagnosticCounts( uint8_t address )
 {
 	writeRemoteRegister( address, SCMD_U_I2C_RD_ERR, 0 );
@@ -534,15 +922,25 @@ void SCMD::writeRegister(uint8_t offset, uint8_t dataToWrite)
 //    Read data from a slave.  Note that this waits 5ms for slave data to be aquired
 //  before making the final read.
 //
-//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x5F for slave 1 to 16.
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
 //  uint8_t offset -- Address of data to read.  Can be 0x00 to 0x7F
 uint8_t SCMD::readRemoteRegister(uint8_t address, uint8_t offset)
 {
 	//while(busy());
 	writeRegister(SCMD_REM_ADDR, address);
 	writeRegister(SCMD_REM_OFFSET, offset);
-	writeRegister(SCMD_REM_READ, 1);
-	while(busy());
+	if( alertPinUsable() )
+	{
+		writeRegister(SCMD_EVENT_FLAGS, SCMD_EVT_REMOTE_DONE);
+		writeRegister(SCMD_REM_READ, 1);
+		//Poll if the event never showed
+		if( waitForEvent(SCMD_EVT_REMOTE_DONE) == 0 ) while(busy());
+	}
+	else
+	{
+		writeRegister(SCMD_REM_READ, 1);
+		while(busy());
+	}
 	uint8_t result = readRegister(SCMD_REM_DATA_RD);
 #ifdef VERBOSE_SERIAL		
 	Serial.print("~R");
@@ -561,7 +959,7 @@ uint8_t SCMD::readRemoteRegister(uint8_t address, uint8_t offset)
 //
 //    Write data from a slave
 //
-//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x5F for slave 1 to 16.
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
 //  uint8_t offset -- Address of data to write.  Can be 0x00 to 0x7F
 //  uint8_t dataToWrite -- Data to write.
 void SCMD::writeRemoteRegister(uint8_t address, uint8_t offset, uint8_t dataToWrite)
@@ -570,8 +968,18 @@ void SCMD::writeRemoteRegister(uint8_t address, uint8_t offset, uint8_t dataToWr
 	writeRegister(SCMD_REM_ADDR, address);
 	writeRegister(SCMD_REM_OFFSET, offset);
 	writeRegister(SCMD_REM_DATA_WR, dataToWrite);
-	writeRegister(SCMD_REM_WRITE, 1);
-	while(busy());
+	if( alertPinUsable() )
+	{
+		writeRegister(SCMD_EVENT_FLAGS, SCMD_EVT_REMOTE_DONE);
+		writeRegister(SCMD_REM_WRITE, 1);
+		//Poll if the event never showed
+		if( waitForEvent(SCMD_EVT_REMOTE_DONE) == 0 ) while(busy());
+	}
+	else
+	{
+		writeRegister(SCMD_REM_WRITE, 1);
+		while(busy());
+	}
 #ifdef VERBOSE_SERIAL		
 	Serial.print("~W");
 	Serial.print(address, HEX);
@@ -581,3 +989,339 @@ void SCMD::writeRemoteRegister(uint8_t address, uint8_t offset, uint8_t dataToWr
 	Serial.println("");
 #endif
 }
+
+//readRegisters( ... )
+//
+//    Read consecutive registers from the master.  I2C does this in one transfer
+//  if the firmware has SCMD_CAP_I2C_BURST, SPI reads one at a time.
+//
+//  uint8_t offset -- Address of first data to read.
+//  uint8_t * data -- Location to put the data
+//  uint8_t length -- Number of bytes, up to 32
+void SCMD::readRegisters(uint8_t offset, uint8_t * data, uint8_t length)
+{
+	uint8_t i = 0;
+	if( length > 32 ) length = 32;
+	switch (settings.commInterface) {
+
+	case I2C_MODE:
+		if( capabilities & SCMD_CAP_I2C_BURST )
+		{
+			Wire.beginTransmission(settings.I2CAddress);
+			Wire.write(offset);
+#ifdef USE_ALT_I2C
+			if(Wire.endTransmission(I2C_STOP, I2C_FAULT_TIMEOUT)) i2cFaults++;
+			if( Wire.requestFrom(settings.I2CAddress, length, I2C_STOP, I2C_FAULT_TIMEOUT) == 0 )i2cFaults++;
+#else
+			Wire.endTransmission();
+			Wire.requestFrom(settings.I2CAddress, length);
+#endif
+			while (( Wire.available() )&&( i < length )) // slave may send less than requested
+			{
+				data[i] = Wire.read();
+				i++;
+			}
+			break;
+		}
+		//No bursts, same as SPI
+	case SPI_MODE:
+		for( i = 0; i < length; i++ )
+		{
+			data[i] = readRegister( offset + i );
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+//readPage( ... )
+//
+//    Read consecutive registers from a register page.  I2C selects the page and
+//  offset in the same transfer if the firmware has SCMD_CAP_PAGE_IN_WRITE,
+//  otherwise the page is selected first.
+//
+//  uint8_t page -- SCMD_PAGE_ number
+//  uint8_t offset -- Address of first data to read on the page.
+//  uint8_t * data -- Location to put the data
+//  uint8_t length -- Number of bytes, up to 32
+void SCMD::readPage(uint8_t page, uint8_t offset, uint8_t * data, uint8_t length)
+{
+	uint8_t i = 0;
+	if( length > 32 ) length = 32;
+	switch (settings.commInterface) {
+
+	case I2C_MODE:
+		if( capabilities & SCMD_CAP_PAGE_IN_WRITE )
+		{
+			Wire.beginTransmission(settings.I2CAddress);
+			Wire.write(SCMD_PAGE_SELECT);
+			Wire.write(page);
+			Wire.write(offset);
+#ifdef USE_ALT_I2C
+			if(Wire.endTransmission(I2C_STOP, I2C_FAULT_TIMEOUT)) i2cFaults++;
+			if( Wire.requestFrom(settings.I2CAddress, length, I2C_STOP, I2C_FAULT_TIMEOUT) == 0 )i2cFaults++;
+#else
+			Wire.endTransmission();
+			Wire.requestFrom(settings.I2CAddress, length);
+#endif
+			while (( Wire.available() )&&( i < length )) // slave may send less than requested
+			{
+				data[i] = Wire.read();
+				i++;
+			}
+			break;
+		}
+		//Select first, same as SPI
+	case SPI_MODE:
+		writeRegister(SCMD_PAGE_SELECT, page);
+		readRegisters(offset, data, length);
+		break;
+
+	default:
+		break;
+	}
+	writeRegister(SCMD_PAGE_SELECT, 0);
+}
+
+//writePage( ... )
+//
+//    Write consecutive registers on a register page.  Like readPage(), I2C only
+//  selects the page in the same transfer with SCMD_CAP_PAGE_IN_WRITE.
+//
+//  uint8_t page -- SCMD_PAGE_ number
+//  uint8_t offset -- Address of first data to write on the page.
+//  const uint8_t * data -- Data to write
+//  uint8_t length -- Number of bytes, up to 29
+void SCMD::writePage(uint8_t page, uint8_t offset, const uint8_t * data, uint8_t length)
+{
+	uint8_t i;
+	if( length > 29 ) length = 29;
+	switch (settings.commInterface)
+	{
+	case I2C_MODE:
+		if( capabilities & SCMD_CAP_PAGE_IN_WRITE )
+		{
+			Wire.beginTransmission(settings.I2CAddress);
+			Wire.write(SCMD_PAGE_SELECT);
+			Wire.write(page);
+			Wire.write(offset);
+			for( i = 0; i < length; i++ )
+			{
+				Wire.write(data[i]);
+			}
+#ifdef USE_ALT_I2C
+			if(Wire.endTransmission(I2C_STOP,I2C_FAULT_TIMEOUT)) i2cFaults++;
+#else
+			Wire.endTransmission();
+#endif
+			break;
+		}
+		//Select first, same as SPI
+	case SPI_MODE:
+		writeRegister(SCMD_PAGE_SELECT, page);
+		writeRegisters(offset, data, length);
+		break;
+
+	default:
+		break;
+	}
+	writeRegister(SCMD_PAGE_SELECT, 0);
+}
+
+//writeRegisters( ... )
+//
+//    Write consecutive registers on the master.  I2C does this in one transfer
+//  if the firmware has SCMD_CAP_I2C_BURST, SPI writes one at a time.  A burst
+//  that runs past SCMD_REMQ_OP wraps back to SCMD_REMQ_ADDR on the I2C port.
+//  Don't start a burst at SCMD_PAGE_SELECT: with SCMD_CAP_PAGE_IN_WRITE the
+//  firmware reads it as a page switch (use writePage()).
+//
+//  uint8_t offset -- Address of first data to write.
+//  const uint8_t * data -- Data to write
+//  uint8_t length -- Number of bytes, up to 31
+void SCMD::writeRegisters(uint8_t offset, const uint8_t * data, uint8_t length)
+{
+	uint8_t i;
+	if( length > 31 ) length = 31;
+	switch (settings.commInterface)
+	{
+	case I2C_MODE:
+		if( capabilities & SCMD_CAP_I2C_BURST )
+		{
+			Wire.beginTransmission(settings.I2CAddress);
+			Wire.write(offset);
+			for( i = 0; i < length; i++ )
+			{
+				Wire.write(data[i]);
+			}
+#ifdef USE_ALT_I2C
+			if(Wire.endTransmission(I2C_STOP,I2C_FAULT_TIMEOUT)) i2cFaults++;
+#else
+			Wire.endTransmission();
+#endif
+			break;
+		}
+		//No bursts, same as SPI
+	case SPI_MODE:
+		for( i = 0; i < length; i++ )
+		{
+			writeRegister( offset, data[i] );
+			//Match the I2C queue wrap
+			if( offset == SCMD_REMQ_OP ) offset = SCMD_REMQ_ADDR;
+			else offset++;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+//****************************************************************************//
+//
+//  Queued Remote Access
+//
+//    Remote ops are queued on the master and run in the background.  Each gets a
+//  request ID.  Poll remoteDone(), then collect the data with getRemoteResult().
+//  Up to SCMD_REMQ_DEPTH requests can be outstanding.
+//
+//    Firmware without the queue (SCMD_CAP_REMOTE_QUEUE and SCMD_CAP_PAGING) has
+//  other registers at these offsets, so nothing is written.  Requests then
+//  report done and failed straight away.
+//
+//****************************************************************************//
+
+//queueRemoteRead( ... )
+//
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
+//  uint8_t offset -- Address of data to read.  Can be 0x00 to 0x7F
+uint8_t SCMD::queueRemoteRead(uint8_t address, uint8_t offset)
+{
+	if( !remoteQueueUsable() ) return 0;
+	uint8_t entry[4] = { address, offset, 0, SCMD_REMQ_OP_READ };
+	writeRegisters( SCMD_REMQ_ADDR, entry, 4 );
+	return readRegister( SCMD_REMQ_ID );
+}
+
+//queueRemoteWrite( ... )
+//
+//  uint8_t address -- Address of slave to write.  Can be 0x50 to 0x6F for slave 1 to 32.
+//  uint8_t offset -- Address of data to write.  Can be 0x00 to 0x7F
+//  uint8_t dataToWrite -- Data to write.
+uint8_t SCMD::queueRemoteWrite(uint8_t address, uint8_t offset, uint8_t dataToWrite)
+{
+	if( !remoteQueueUsable() ) return 0;
+	uint8_t entry[4] = { address, offset, dataToWrite, SCMD_REMQ_OP_WRITE };
+	writeRegisters( SCMD_REMQ_ADDR, entry, 4 );
+	return readRegister( SCMD_REMQ_ID );
+}
+
+//queueRemoteReads( ... )
+//
+//    Queue several reads from one slave in a single transfer.  IDs are consecutive,
+//  the first is (returned ID - count + 1).
+//
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
+//  const uint8_t * offsets -- List of offsets to read
+//  uint8_t count -- Number of offsets, up to 7
+uint8_t SCMD::queueRemoteReads(uint8_t address, const uint8_t * offsets, uint8_t count)
+{
+	uint8_t entries[28];
+	if( !remoteQueueUsable() ) return 0;
+	if( count > 7 ) count = 7;
+	for( uint8_t i = 0; i < count; i++ )
+	{
+		entries[i * 4] = address;
+		entries[i * 4 + 1] = offsets[i];
+		entries[i * 4 + 2] = 0;
+		entries[i * 4 + 3] = SCMD_REMQ_OP_READ;
+	}
+	writeRegisters( SCMD_REMQ_ADDR, entries, count * 4 );
+	return readRegister( SCMD_REMQ_ID );
+}
+
+//remoteDone( ... )
+//
+//  uint8_t requestId -- ID returned when the op was queued
+bool SCMD::remoteDone(uint8_t requestId)
+{
+	if( !remoteQueueUsable() ) return true;
+	//IDs wrap, so compare by distance
+	return (int8_t)(readRegister( SCMD_REMQ_DONE ) - requestId) >= 0;
+}
+
+//getRemoteResult( ... )
+//
+//    Reads from the results page.  Only valid for the last SCMD_REMQ_DEPTH requests.
+//
+//  uint8_t requestId -- ID returned when the op was queued
+uint8_t SCMD::getRemoteResult(uint8_t requestId)
+{
+	uint8_t result = 0;
+	if( !remoteQueueUsable() ) return 0;
+	readPage( SCMD_PAGE_REMQ_RESULTS, requestId % SCMD_REMQ_DEPTH, &result, 1 );
+	return result;
+}
+
+//remoteFailed( ... )
+//
+//    Returns 1 if a completed request failed (a read's result is then not data).
+//
+//  uint8_t requestId -- ID returned when the op was queued
+bool SCMD::remoteFailed(uint8_t requestId)
+{
+	uint8_t slot = requestId % SCMD_REMQ_DEPTH;
+	uint8_t errors;
+	if( !remoteQueueUsable() ) return true;
+	readPage( SCMD_PAGE_REMQ_RESULTS, SCMD_REMQ_ERRORS + ( slot >> 3 ), &errors, 1 );
+	return ( errors >> ( slot & 0x07 )) & 0x01;
+}
+
+//****************************************************************************//
+//
+//  Remote Block Access
+//
+//    The master copies a range of slave registers to or from a window page in
+//  one expansion transfer.  Dump a full slave with 4 calls of 32 bytes.
+//
+//****************************************************************************//
+
+//readRemoteBlock( ... )
+//
+//  uint8_t address -- Address of slave to read.  Can be 0x50 to 0x6F for slave 1 to 32.
+//  uint8_t offset -- Address of first data to read.
+//  uint8_t * data -- Location to put the data
+//  uint8_t length -- Number of bytes, up to SCMD_REM_BLK_MAX
+void SCMD::readRemoteBlock(uint8_t address, uint8_t offset, uint8_t * data, uint8_t length)
+{
+	if( length > SCMD_REM_BLK_MAX ) length = SCMD_REM_BLK_MAX;
+	uint8_t target[2] = { address, offset };
+	uint8_t command[2] = { length, SCMD_REM_BLK_READ };
+	while(busy());
+	writeRegisters( SCMD_REM_ADDR, target, 2 );
+	writeRegisters( SCMD_REM_BLK_LEN, command, 2 );
+	while(busy());
+	readPage( SCMD_PAGE_REM_BLOCK, 0, data, length );
+}
+
+//writeRemoteBlock( ... )
+//
+//  uint8_t address -- Address of slave to write.  Can be 0x50 to 0x6F for slave 1 to 32.
+//  uint8_t offset -- Address of first data to write.
+//  const uint8_t * data -- Data to write
+//  uint8_t length -- Number of bytes, up to SCMD_REM_BLK_MAX
+void SCMD::writeRemoteBlock(uint8_t address, uint8_t offset, const uint8_t * data, uint8_t length)
+{
+	if( length > SCMD_REM_BLK_MAX ) length = SCMD_REM_BLK_MAX;
+	uint8_t target[2] = { address, offset };
+	uint8_t command[2] = { length, SCMD_REM_BLK_WRITE };
+	while(busy());
+	//Fill the window in halves, a full block plus page and offset won't fit one I2C transfer
+	writePage( SCMD_PAGE_REM_BLOCK, 0, data, ( length > 16 ) ? 16 : length );
+	if( length > 16 ) writePage( SCMD_PAGE_REM_BLOCK, 16, data + 16, length - 16 );
+	writeRegisters( SCMD_REM_ADDR, target, 2 );
+	writeRegisters( SCMD_REM_BLK_LEN, command, 2 );
+	while(busy());
+}
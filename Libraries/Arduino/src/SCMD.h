@@ -29,6 +29,8 @@ Distributed as-is; no warranty is given.
 #define I2C_MODE 0
 #define SPI_MODE 1
 
+#define SCMD_NO_ALERT_PIN 0xFF
+
 //  SCMDSettings
 //
 //    This is used by the SCMD class to hold settings.  It is public within that class
@@ -42,6 +44,7 @@ struct SCMDSettings
     uint8_t commInterface;  //Set equal to I2C_MODE or SPI_MODE
     uint8_t I2CAddress;  //Set to address that master is configured to in case of I2C usage
     uint8_t chipSelectPin;  //Set to chip select pin used on Arduino in case of SPI
+    uint8_t alertPin;  //Pin wired to the SCMD's HOST_ALERT output, or SCMD_NO_ALERT_PIN to poll (also polls if the firmware has no SCMD_CAP_HOST_ALERT)
 
 };
 
@@ -70,6 +73,30 @@ struct SCMDDiagnostics
 
  };
 
+//  SCMDWideDiagnostics
+//
+//    32 bit copies of the master's counters, taken together by getWideDiagnostics().
+//  They stop at 0xFFFFFFFF rather than wrapping.
+struct SCMDWideDiagnostics
+{
+	public:
+	uint32_t U_I2C_RD_ERR = 0;
+	uint32_t U_I2C_WR_ERR = 0;
+	uint32_t U_BUF_DUMPED = 0;
+	uint32_t E_I2C_RD_ERR = 0;
+	uint32_t E_I2C_WR_ERR = 0;
+	uint32_t SLV_POLL_CNT = 0;
+	uint32_t MST_E_ERR = 0;
+	uint32_t FSAFE_FAULTS = 0;
+	uint32_t REG_OOR_CNT = 0;
+	uint32_t REG_RO_WRITE_CNT = 0;
+	uint32_t FRAME_LATE_CNT = 0;
+	uint32_t HOTPLUG_CNT = 0;
+	uint32_t REJOIN_CNT = 0;
+	uint32_t latchTime = 0; //ms since the SCMD powered up
+
+ };
+
 //  SCMD
 //
 //    This object provides control of a motor driver and attached slave chain, for
@@ -86,17 +113,35 @@ class SCMD
     SCMD( void );
 	
 	
-    uint8_t begin( void );  //Call to apply SCMDSettings and returns ID word
+    uint8_t begin( void );  //Call to apply SCMDSettings and returns ID word.  Reads the capability page and picks transfers to match
+	bool readCapabilities( uint8_t * caps ); //Fills SCMD_CAP_LENGTH bytes, returns 0 if the firmware has no capability page
+	bool hasCapability( uint16_t flags ); //Returns 1 if the firmware has all the SCMD_CAP_ bits (known after begin())
 	bool ready( void ); //Returns 1 when enumeration is complete
 	bool busy( void ); //Returns 1 while the SCMD is busy with tasks that should not be interrupted
+	uint8_t lastOperation( void ); //Sequence number of the last async register write
+	bool saveConfig( void ); //Store inversion, bridging, rates, failsafe and baud in flash, returns 1 on success
+	bool clearConfig( void ); //Forget stored settings, next boot uses defaults
+	bool exportConfig( uint8_t * blob ); //Fills SCMD_BLOB_SIZE bytes with the current settings
+	bool importConfig( const uint8_t * blob, uint16_t timeoutMs = 1000 ); //Applies a blob from exportConfig(), returns 0 if refused or the slaves weren't updated in time
+	bool operationDone( uint8_t sequence ); //Returns 1 once that write and all before it are finished
 	void enable( void ); //Sets all connected SCMDs to enable
 	void disable( void ); //Sets all connected SCMDs to disable
 	void reset( void );  //Software reset routine
-    void setDrive( uint8_t motorNum, uint8_t direction, uint8_t level );//apply drive levels to motors
-	void inversionMode( uint8_t motorNum, uint8_t polarity );//Set inversion states for motors
-	void bridgingMode( uint8_t driverNum, uint8_t bridged );//Enable bridging ('B' channel will have no effect in bridged mode)
+    void setDrive( uint16_t motorNum, uint8_t direction, uint8_t level );//apply drive levels to motors
+	void inversionMode( uint16_t motorNum, uint8_t polarity );//Set inversion states for motors
+	void bridgingMode( uint16_t driverNum, uint8_t bridged );//Enable bridging ('B' channel will have no effect in bridged mode)
+	void updateDivisor( uint8_t driverNum, uint8_t divisor );//Send a slave's drives every n-th frame
 	void getDiagnostics( SCMDDiagnostics &diagObjectReference );//Gets and formats the diagnostic information.  Make sure the passed char array is big enough (size not determined yet)
 	void getRemoteDiagnostics( uint8_t address, SCMDDiagnostics &diagObjectReference );//send remote address
+	void getMirroredDiagnostics( uint8_t address, SCMDDiagnostics &diagObjectReference );//Same as above, from the master's telemetry page (no remote reads)
+	void getWideDiagnostics( SCMDWideDiagnostics &diagObjectReference, bool clearAfter = false );//Snapshot of the 32 bit counters, optionally zeroing them
+	uint8_t getSlaveFaults( uint8_t address );//Faults collected from a slave, cleared on read
+	uint16_t getChangedRegisters( uint8_t * bitmap );//Fills 16 bytes, bit n set if register n changed since acknowledged.  Returns the change generation
+	void ackChangedRegisters( const uint8_t * bitmap );//Acknowledge the set bits of a 16 byte map
+	void readAccessStats( uint8_t firstRegister, uint16_t * reads, uint16_t * writes );//16 registers of host access counts (REGISTER_ACCESS_STATS firmware)
+	void getHotRegisters( uint8_t * registers, uint16_t * hits );//SCMD_AST_HOT_COUNT most accessed registers, most first
+	void resetAccessStats( void );
+	uint8_t waitForEvent( uint8_t eventMask, uint16_t timeoutMs = 1000 );//Waits for SCMD_EVT_ bits, returns (and clears) the ones seen, 0 on timeout
 	void resetDiagnosticCounts( void );
 	void resetRemoteDiagnosticCounts( uint8_t address );
 	
@@ -106,10 +151,33 @@ class SCMD
     void writeRegister(uint8_t offset, uint8_t dataToWrite);//Writes a byte;
     uint8_t readRemoteRegister(uint8_t address, uint8_t offset);//Reads a slave through the slave access registers
     void writeRemoteRegister(uint8_t address, uint8_t offset, uint8_t dataToWrite);//Writes a slave through the slave access registers
+    void readRegisters(uint8_t offset, uint8_t * data, uint8_t length);//Reads consecutive bytes (I2C burst with SCMD_CAP_I2C_BURST, max 32)
+    void writeRegisters(uint8_t offset, const uint8_t * data, uint8_t length);//Writes consecutive bytes (I2C burst, max 31)
+    void readPage(uint8_t page, uint8_t offset, uint8_t * data, uint8_t length);//Reads from a register page, leaves page 0 selected
+    void writePage(uint8_t page, uint8_t offset, const uint8_t * data, uint8_t length);//Writes to a register page (I2C max 29), leaves page 0 selected
+	
+	//Queued remote access.  Ops run in the background and return a request ID
+    uint8_t queueRemoteRead(uint8_t address, uint8_t offset);//Returns request ID
+    uint8_t queueRemoteWrite(uint8_t address, uint8_t offset, uint8_t dataToWrite);//Returns request ID
+    uint8_t queueRemoteReads(uint8_t address, const uint8_t * offsets, uint8_t count);//Queues up to 7 reads in one transfer, returns ID of the last
+    bool remoteDone(uint8_t requestId);//Returns 1 once the request has completed
+    uint8_t getRemoteResult(uint8_t requestId);//Read data (or write status) of a completed request
+    bool remoteFailed(uint8_t requestId);//Returns 1 if a completed request failed
+	
+	//Remote block access, moves up to SCMD_REM_BLK_MAX consecutive slave registers per transfer
+    void readRemoteBlock(uint8_t address, uint8_t offset, uint8_t * data, uint8_t length);
+    void writeRemoteBlock(uint8_t address, uint8_t offset, const uint8_t * data, uint8_t length);
+	
+	//SCMD_CAP_ bits read by begin(), 0 for older firmware (single register transfers only)
+	uint16_t capabilities;
 	
 	//Diagnostic
 	uint16_t i2cFaults; //Location to hold i2c faults for alternate driver
 	
+  private:
+	bool alertPinUsable( void ); //Alert pin configured and driven by the firmware
+	bool remoteQueueUsable( void ); //Firmware has the remote queue and its results page
+	
 };
 
 
@@ -21,22 +21,49 @@ Distributed as-is; no warranty is given.
 //defaults ( Set config in PSoC, use for reference in Arduino )   
 #define ID_WORD                    0xA9  //Device ID to be programmed into memory for reads
 #define START_SLAVE_ADDR           0x50  //Start address of slaves
-#define MAX_SLAVE_ADDR             0x5F  //Max address of slaves
+#define MAX_SLAVE_ADDR             0x6F  //Max address of slaves (32, slaves from SCMD_EXT_SLAVE_ADDR are on SCMD_PAGE_EXT_SLAVES)
 #define MASTER_LOCK_KEY            0x9B
 #define USER_LOCK_KEY              0x5C
-#define FIRMWARE_VERSION           0x05
+#define FIRMWARE_VERSION           0x07
 #define POLL_ADDRESS               0x4A  //Address of an unasigned, ready slave
 #define MAX_POLL_LIMIT             0xC8  //200
+#define SLAVE_REJOIN_TIMEOUT_MS    200   //CONFIG_IN low longer than this resets a slave
+#define BROADCAST_ADDR             0x00  //Expansion bus general call, carries broadcast drive frames
+#define BROADCAST_TAG              0xBC  //First byte of a broadcast frame (not a register offset)
 
 //SCMD_STATUS_1 bits
 #define SCMD_ENUMERATION_BIT       0x01
 #define SCMD_BUSY_BIT              0x02
 #define SCMD_REM_READ_BIT          0x04
 #define SCMD_REM_WRITE_BIT         0x08
+#define SCMD_SLV_FAULT_BIT         0x10  //A slave has reported a fault, see SCMD_PAGE_SLAVE_FAULTS
+
+//SCMD_FAULT_FLAGS bits, latched until cleared by the master
+#define SCMD_FAULT_FSAFE           0x01  //Failsafe timer expired
+#define SCMD_FAULT_E_I2C           0x02  //Expansion port transfer error
+#define SCMD_FAULT_NO_ACK          0x80  //Master only: slave didn't take its drive frame
+
+//SCMD_EVENT_FLAGS and SCMD_EVENT_MASK bits.  Flags latch, write 1s to clear.  Boards
+//with the optional HOST_ALERT pin pull it low while (flags & mask) != 0.
+#define SCMD_EVT_ENUM_DONE         0x01
+#define SCMD_EVT_BUSY_CLEAR        0x02
+#define SCMD_EVT_FSAFE             0x04
+#define SCMD_EVT_REMOTE_DONE       0x08  //Remote window, block or queued op finished
+#define SCMD_EVT_SLV_FAULT         0x10
 
 //SCMD_CONTROL_1 bits
 #define SCMD_FULL_RESET_BIT        0x01
 #define SCMD_RE_ENUMERATE_BIT      0x02
+#define SCMD_TIMING_RESET_BIT      0x04  //Clear frame period statistics
+#define SCMD_SAVE_CONFIG_BIT       0x08  //Write settings to flash, restored at boot
+#define SCMD_CLEAR_CONFIG_BIT      0x10  //Forget saved settings
+
+//SCMD_CONFIG_STATUS bits
+#define SCMD_CFG_RESTORED          0x01  //Saved settings were loaded at boot
+#define SCMD_CFG_SAVED             0x02  //Last save succeeded
+#define SCMD_CFG_FAILED            0x04  //Last save or clear failed to program flash
+#define SCMD_CFG_IMPORTED          0x08  //Last blob import was applied
+#define SCMD_CFG_REJECTED          0x10  //Last blob import failed its checks (or settings are locked)
     
 //SCMD_FSAFE_CTRL bits and masks
 #define SCMD_FSAFE_DRIVE_KILL      0x01
@@ -53,6 +80,177 @@ Distributed as-is; no warranty is given.
 #define SCMD_M_IN_CYCLE_USER      0x04
 #define SCMD_M_IN_CYCLE_EXP       0x08
 
+//SCMD_REMQ_OP operations
+#define SCMD_REMQ_OP_READ          0x01
+#define SCMD_REMQ_OP_WRITE         0x02
+#define SCMD_REMQ_DEPTH            0x20  //Queue entries, results are at the start of the results page
+
+//Results page layout after the results
+#define SCMD_REMQ_ERRORS           0x20  //4 bytes, bit (n % SCMD_REMQ_DEPTH) set if op n failed
+#define SCMD_REMQ_OVFL_CNT         0x24  //Ops dropped because the queue was full
+#define SCMD_REMQ_PAGE_LENGTH      0x25
+
+//SCMD_REM_BLK_OP operations
+#define SCMD_REM_BLK_READ          0x01
+#define SCMD_REM_BLK_WRITE         0x02
+#define SCMD_REM_BLK_MAX           0x20  //Max SCMD_REM_BLK_LEN, also size of the block window page
+
+//SCMD_MST_BG_CTRL bits (master background expansion traffic)
+#define SCMD_BG_TELEMETRY_EN       0x01
+#define SCMD_BG_HOTPLUG_EN         0x02  //Watch POLL_ADDRESS and add new slaves to the end of the chain
+
+//SCMD_FRAME_CTRL bits
+#define SCMD_FRAME_BROADCAST       0x01  //Send all slave drives in one general call write
+
+//Telemetry page layout, slave n (0 based) starts at n * SCMD_TLM_STRIDE
+#define SCMD_TLM_STRIDE            0x06
+#define SCMD_TLM_E_I2C_RD_ERR      0x00
+#define SCMD_TLM_E_I2C_WR_ERR      0x01
+#define SCMD_TLM_LOOP_TIME         0x02
+#define SCMD_TLM_FSAFE_FAULTS      0x03
+#define SCMD_TLM_REG_OOR_CNT       0x04
+#define SCMD_TLM_REG_RO_WRITE_CNT  0x05
+
+//Timing page layout, values are 32 bit little endian us (timestamps and times)
+#define SCMD_TIM_FRAME_START       0x00  //Last drive frame started
+#define SCMD_TIM_FRAME_END         0x04  //Last drive frame completed
+#define SCMD_TIM_PERIOD_LAST       0x08  //Start to start time of the last two frames
+#define SCMD_TIM_PERIOD_MIN        0x0C
+#define SCMD_TIM_PERIOD_MAX        0x10
+#define SCMD_TIM_JITTER_AVG        0x14  //Average distance of the period from the set rate
+#define SCMD_TIM_JITTER_MAX        0x18
+
+//Diagnostics page layout, 32 bit little endian counters that stop at 0xFFFFFFFF.
+//Written only when SCMD_DIAG_SNAP is written to SCMD_DIAG_LATCH.
+#define SCMD_DIAG_U_I2C_RD_ERR     0x00
+#define SCMD_DIAG_U_I2C_WR_ERR     0x04
+#define SCMD_DIAG_U_BUF_DUMPED     0x08
+#define SCMD_DIAG_E_I2C_RD_ERR     0x0C
+#define SCMD_DIAG_E_I2C_WR_ERR     0x10
+#define SCMD_DIAG_SLV_POLL_CNT     0x14
+#define SCMD_DIAG_MST_E_ERR        0x18
+#define SCMD_DIAG_FSAFE_FAULTS     0x1C
+#define SCMD_DIAG_REG_OOR_CNT      0x20
+#define SCMD_DIAG_REG_RO_WRITE_CNT 0x24
+#define SCMD_DIAG_FRAME_LATE_CNT   0x28
+#define SCMD_DIAG_HOTPLUG_CNT      0x2C
+#define SCMD_DIAG_REJOIN_CNT       0x30
+#define SCMD_DIAG_LATCH_TIME       0x34  //ms since power up when the snapshot was taken
+#define SCMD_DIAG_LENGTH           0x38
+
+//SCMD_DIAG_LATCH bits
+#define SCMD_DIAG_SNAP             0x01  //Copy the counters to SCMD_PAGE_DIAG
+#define SCMD_DIAG_CLEAR            0x02  //Zero the counters (after the copy if both are set)
+
+//Change page layout.  The generation goes up on every register change, and the
+//register's bit is set until the host writes a 1 to it.  Acknowledge before
+//reading the changed registers so nothing that changes in between is lost.
+#define SCMD_CHG_GEN_L             0x00
+#define SCMD_CHG_GEN_H             0x01
+#define SCMD_CHG_BITMAP            0x02  //16 bytes, register n is bit (n % 8) of byte (n / 8)
+#define SCMD_CHG_LENGTH            0x12
+
+//Access statistics page layout, only on firmware built with REGISTER_ACCESS_STATS.
+//Refreshed by writing SCMD_AST_CTRL.  Counts are 16 bit little endian, stop at 0xFFFF.
+#define SCMD_AST_WINDOW            0x00  //Registers from the last SCMD_AST_CTRL value: reads, writes
+#define SCMD_AST_WINDOW_REGS       0x10
+#define SCMD_AST_WINDOW_STRIDE     0x04
+#define SCMD_AST_HOT               0x40  //Register, hits (reads + writes), most hit first
+#define SCMD_AST_HOT_COUNT         0x08
+#define SCMD_AST_HOT_STRIDE        0x03
+#define SCMD_AST_REFUSED           0x58  //16 bytes, bit n set if a host access to offset n was refused
+#define SCMD_AST_CTRL              0x68  //Write a register number to snapshot from it, or SCMD_AST_RESET
+#define SCMD_AST_LENGTH            0x69
+#define SCMD_AST_RESET             0x80
+
+//Config blob page layout.  Write SCMD_BLOB_EXPORT to SCMD_BLOB_CTRL to fill the
+//blob with the current settings.  To load settings, write the blob and then
+//SCMD_BLOB_IMPORT to SCMD_BLOB_CTRL (one 29 byte burst from SCMD_BLOB_VERSION).
+//SCMD_BLOB_CTRL reads SCMD_BLOB_IMPORT until the slaves have been sent theirs,
+//then SCMD_CONFIG_STATUS tells if it was applied.  Only settings the blob changes
+//are lock checked: those need SCMD_USER_LOCK open (the default), and a different
+//SCMD_U_BUS_UART_BAUD also needs MASTER_LOCK_KEY in SCMD_MASTER_LOCK.
+#define SCMD_BLOB_VERSION          0x00  //SCMD_BLOB_FORMAT
+#define SCMD_BLOB_LENGTH           0x01  //Bytes of settings that follow
+#define SCMD_BLOB_DATA             0x02
+#define SCMD_BLOB_CRC              0x1A  //CRC-16/CCITT of everything before it, little endian
+#define SCMD_BLOB_SIZE             0x1C
+#define SCMD_BLOB_CTRL             0x1C
+#define SCMD_BLOB_PAGE_LENGTH      0x1D
+#define SCMD_BLOB_FORMAT           0x01
+#define SCMD_BLOB_EXPORT           0x01
+#define SCMD_BLOB_IMPORT           0x02
+
+//Capability page layout, read only.  Tells a host what this image supports so it
+//doesn't have to go by SCMD_FID.  Firmware before SCMD_CAP_FIRST_FID has no page
+//(reads of it return 0).
+#define SCMD_CAP_FIRST_FID         0x07
+#define SCMD_CAP_VERSION           0x00  //SCMD_CAP_FORMAT
+#define SCMD_CAP_FLAGS_L           0x01  //SCMD_CAP_* feature bits, little endian
+#define SCMD_CAP_FLAGS_H           0x02
+#define SCMD_CAP_ROLE              0x03  //Compile time role, 0 if the jumpers choose (see buildRole.h)
+#define SCMD_CAP_U_I2C_SPEED       0x04  //Max user port I2C clock, 100 kHz units
+#define SCMD_CAP_U_BAUD_MAX        0x05  //Highest SCMD_U_BUS_UART_BAUD setting
+#define SCMD_CAP_E_BUS_SPEED_MAX   0x06  //Highest SCMD_E_BUS_SPEED setting
+#define SCMD_CAP_READ_BURST        0x07  //Longest I2C read burst
+#define SCMD_CAP_WRITE_BURST       0x08  //Longest I2C write, offset byte included
+#define SCMD_CAP_REMQ_DEPTH        0x09
+#define SCMD_CAP_REM_BLK_MAX       0x0A
+#define SCMD_CAP_MAX_SLAVES        0x0B
+#define SCMD_CAP_PAGE_COUNT        0x0C  //Pages including page 0
+#define SCMD_CAP_LENGTH            0x0D
+#define SCMD_CAP_FORMAT            0x01
+
+//SCMD_CAP_FLAGS bits
+#define SCMD_CAP_I2C_BURST         0x0001  //Burst reads and writes on the I2C user port
+#define SCMD_CAP_PAGING            0x0002  //SCMD_PAGE_SELECT
+#define SCMD_CAP_PAGE_IN_WRITE     0x0004  //I2C page select and offset in one transfer
+#define SCMD_CAP_BROADCAST         0x0008  //SCMD_FRAME_BROADCAST drive frames
+#define SCMD_CAP_REMOTE_QUEUE      0x0010  //SCMD_REMQ_* queued remote ops
+#define SCMD_CAP_REMOTE_BLOCK      0x0020  //SCMD_REM_BLK_* block transfers
+#define SCMD_CAP_EVENTS            0x0040  //SCMD_EVENT_FLAGS and SCMD_EVENT_MASK
+#define SCMD_CAP_HOST_ALERT        0x0080  //HOST_ALERT pin is driven from the events
+#define SCMD_CAP_OP_SEQ            0x0100  //SCMD_OP_SEQ and SCMD_OP_DONE
+#define SCMD_CAP_CONFIG_SAVE       0x0200  //SCMD_SAVE_CONFIG_BIT and SCMD_CONFIG_STATUS
+#define SCMD_CAP_CONFIG_BLOB       0x0400  //SCMD_PAGE_CONFIG_BLOB
+#define SCMD_CAP_WIDE_DIAG         0x0800  //SCMD_PAGE_DIAG
+#define SCMD_CAP_CHANGES           0x1000  //SCMD_PAGE_CHANGES
+#define SCMD_CAP_ACCESS_STATS      0x2000  //SCMD_PAGE_ACCESS_STATS is live
+#define SCMD_CAP_EXT_SLAVES        0x4000  //Slaves 17 to 32 on SCMD_PAGE_EXT_SLAVES
+
+//Register pages (SCMD_PAGE_SELECT).  Offsets below SCMD_PAGE_LENGTH are paged,
+//offsets from SCMD_PAGE_SELECT up are common to all pages.
+//
+//Protocol rule, firmware 0x07 and later (SCMD_CAP_PAGE_IN_WRITE): on the I2C user
+//port a write of 3 or more bytes starting at SCMD_PAGE_SELECT is always read as
+//SCMD_PAGE_SELECT, page, offset[, data...].  It selects the page and points at
+//offset on it in one transfer.  Such a write is not a burst into the common
+//registers after SCMD_PAGE_SELECT; write SCMD_DRIVER_ENABLE on up separately.  A
+//2 byte write of SCMD_PAGE_SELECT, page is an ordinary register write.  SPI and
+//UART are unchanged.
+#define SCMD_PAGE_LENGTH           0x6F
+#define SCMD_PAGE_REMQ_RESULTS     0x01  //Result of queued op n at offset (n % SCMD_REMQ_DEPTH), see SCMD_REMQ_ERRORS
+#define SCMD_PAGE_REM_BLOCK        0x02  //Remote block window, offset 0 is SCMD_REM_OFFSET on the slave
+#define SCMD_PAGE_TELEMETRY        0x03  //Mirrored slave health, see SCMD_TLM_*
+#define SCMD_PAGE_TIMING           0x04  //Frame timing, see SCMD_TIM_*
+#define SCMD_PAGE_EXT_SLAVES       0x05  //Drive, inversion and bridging for slaves 17 to 32, see SCMD_EXT_*
+#define SCMD_PAGE_TELEMETRY_EXT    0x06  //SCMD_PAGE_TELEMETRY continued, slave 17 at offset 0
+#define SCMD_PAGE_SLAVE_DIV        0x07  //Update divisor per slave, slave 1 at offset 0 (0 or 1 = every frame)
+#define SCMD_PAGE_SLAVE_FAULTS     0x08  //Faults collected from each slave, slave 1 at offset 0 (SCMD_FAULT_*)
+#define SCMD_PAGE_DIAG             0x09  //Wide diagnostic counter snapshot, see SCMD_DIAG_*
+#define SCMD_PAGE_CHANGES          0x0A  //Registers changed since the host last acknowledged, see SCMD_CHG_*
+#define SCMD_PAGE_ACCESS_STATS     0x0B  //Host access counts (REGISTER_ACCESS_STATS builds), see SCMD_AST_*
+#define SCMD_PAGE_CONFIG_BLOB      0x0C  //Settings in one block for export and import, see SCMD_BLOB_*
+#define SCMD_PAGE_CAPS             0x0D  //What the firmware supports, see SCMD_CAP_*
+
+//Extended slave page layout
+#define SCMD_EXT_SLAVE_ADDR        0x60  //First slave on the page (slave 17)
+#define SCMD_EXT_FIRST_MOTOR       0x22  //Motor number of slave 17 'A' (34)
+#define SCMD_EXT_DRIVE             0x00  //Two per slave, like SCMD_S1A_DRIVE
+#define SCMD_EXT_INV               0x20  //4 bytes, motor 34 is bit 0 of the first
+#define SCMD_EXT_BRIDGE            0x24  //2 bytes, slave 17 is bit 0 of the first
+#define SCMD_EXT_LENGTH            0x26
+
 //Address map
 #define SCMD_FID                   0x00
 #define SCMD_ID                    0x01
@@ -127,8 +325,33 @@ Distributed as-is; no warranty is given.
 #define SCMD_INV_26_33             0x53
 #define SCMD_BRIDGE_SLV_L          0x54
 #define SCMD_BRIDGE_SLV_H          0x55
+#define SCMD_FRAME_TIME_L          0x56
+#define SCMD_FRAME_TIME_H          0x57
+#define SCMD_REMQ_ADDR             0x58
+#define SCMD_REMQ_OFFSET           0x59
+#define SCMD_REMQ_DATA             0x5A
+#define SCMD_REMQ_OP               0x5B
+#define SCMD_REMQ_ID               0x5C
+#define SCMD_REMQ_DONE             0x5D
+#define SCMD_REMQ_PENDING          0x5E
+#define SCMD_REM_BLK_LEN           0x5F
+#define SCMD_REM_BLK_OP            0x60
+#define SCMD_MST_BG_CTRL           0x61
+#define SCMD_FRAME_LATE_CNT        0x62
+#define SCMD_HOTPLUG_CNT           0x63
+#define SCMD_REJOIN_CNT            0x64
+#define SCMD_UPDATE_PERIOD_L       0x65  //Frame period in us, overrides SCMD_UPDATE_RATE when not 0
+#define SCMD_UPDATE_PERIOD_H       0x66
+#define SCMD_FAULT_FLAGS           0x67
+#define SCMD_EVENT_FLAGS           0x68
+#define SCMD_EVENT_MASK            0x69
+#define SCMD_FRAME_CTRL            0x6A
+#define SCMD_OP_SEQ                0x6B  //Sequence given to the last async register write
+#define SCMD_OP_DONE               0x6C  //Newest sequence with every op up to it finished
+#define SCMD_CONFIG_STATUS         0x6D
+#define SCMD_DIAG_LATCH            0x6E  //Write SCMD_DIAG_ bits, reads 0
 
-//#define SCMD_PAGE_SELECT           0x6F
+#define SCMD_PAGE_SELECT           0x6F
 #define SCMD_DRIVER_ENABLE         0x70
 #define SCMD_UPDATE_RATE           0x71
 #define SCMD_FORCE_UPDATE          0x72
@@ -145,5 +368,6 @@ Distributed as-is; no warranty is given.
 #define SCMD_REM_DATA_RD           0x7C
 #define SCMD_REM_WRITE             0x7D
 #define SCMD_REM_READ              0x7E
+#define SCMD_PAGE_LEN              0x7F  //Length of the selected page (SCMD_PAGE_LENGTH for page 0, 0 if unmapped)
 
 #endif
\ No newline at end of file